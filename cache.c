@@ -0,0 +1,315 @@
+/*
+ *  cache.c - Implementacao do cache de blocos (buffer cache) do MyFS
+ *
+ *  Autores: Willian Cesar de Sena Melo (Nº UFJF: 202035010)
+ *  Projeto: Trabalho Pratico II - Sistemas Operacionais
+ *  Organizacao: Universidade Federal de Juiz de Fora
+ *  Departamento: Dep. Ciencia da Computacao
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+
+typedef struct cacheEntry
+{
+	unsigned int block;
+	int valid;
+	int dirty;
+	unsigned int pinCount;
+	unsigned char *data;
+	struct cacheEntry *prev; // lista LRU: inicio = usado mais recentemente
+	struct cacheEntry *next;
+	struct cacheEntry *hashNext;
+} CacheEntry;
+
+Disk *cacheDisk = NULL;
+unsigned int cacheBlockSize = 0;
+unsigned int cacheNumEntries = 0;
+CacheEntry *cacheEntries = NULL;
+unsigned char *cacheData = NULL;
+CacheEntry **cacheHash = NULL;
+unsigned int cacheHashSize = 0;
+CacheEntry *cacheLRUHead = NULL;
+CacheEntry *cacheLRUTail = NULL;
+
+void __cacheFree(void)
+{
+	free(cacheEntries);
+	free(cacheData);
+	free(cacheHash);
+	cacheEntries = NULL;
+	cacheData = NULL;
+	cacheHash = NULL;
+	cacheDisk = NULL;
+	cacheNumEntries = 0;
+	cacheLRUHead = NULL;
+	cacheLRUTail = NULL;
+}
+
+CacheEntry *__cacheLookup(unsigned int block)
+{
+	CacheEntry *entry = cacheHash[block % cacheHashSize];
+	while (entry != NULL && entry->block != block)
+		entry = entry->hashNext;
+	return entry;
+}
+
+void __cacheHashRemove(CacheEntry *entry)
+{
+	CacheEntry **link = &cacheHash[entry->block % cacheHashSize];
+	while (*link != NULL && *link != entry)
+		link = &(*link)->hashNext;
+	if (*link != NULL)
+		*link = entry->hashNext;
+	entry->hashNext = NULL;
+}
+
+void __cacheHashInsert(CacheEntry *entry)
+{
+	entry->hashNext = cacheHash[entry->block % cacheHashSize];
+	cacheHash[entry->block % cacheHashSize] = entry;
+}
+
+// Move a entrada para o inicio da lista LRU
+void __cacheTouch(CacheEntry *entry)
+{
+	if (cacheLRUHead == entry)
+		return;
+	entry->prev->next = entry->next;
+	if (entry->next != NULL)
+		entry->next->prev = entry->prev;
+	else
+		cacheLRUTail = entry->prev;
+	entry->prev = NULL;
+	entry->next = cacheLRUHead;
+	cacheLRUHead->prev = entry;
+	cacheLRUHead = entry;
+}
+
+// Move a entrada para o fim da lista LRU, para que seja a proxima reaproveitada
+void __cacheDemote(CacheEntry *entry)
+{
+	if (cacheLRUTail == entry)
+		return;
+	if (entry->prev != NULL)
+		entry->prev->next = entry->next;
+	else
+		cacheLRUHead = entry->next;
+	entry->next->prev = entry->prev;
+	entry->next = NULL;
+	entry->prev = cacheLRUTail;
+	cacheLRUTail->next = entry;
+	cacheLRUTail = entry;
+}
+
+int __cacheWriteSectors(unsigned int block, const unsigned char *data)
+{
+	unsigned int sectorsPerBlock = cacheBlockSize / DISK_SECTORDATASIZE;
+	unsigned long firstSector = (unsigned long)block * sectorsPerBlock;
+	for (unsigned int i = 0; i < sectorsPerBlock; i++)
+		if (diskWriteSector(cacheDisk, firstSector + i, (unsigned char *)&data[i * DISK_SECTORDATASIZE]) == -1)
+			return -1;
+	return 0;
+}
+
+int __cacheWriteBack(CacheEntry *entry)
+{
+	if (__cacheWriteSectors(entry->block, entry->data) == -1)
+		return -1;
+	entry->dirty = 0;
+	return 0;
+}
+
+int __cacheLoad(CacheEntry *entry)
+{
+	unsigned int sectorsPerBlock = cacheBlockSize / DISK_SECTORDATASIZE;
+	unsigned long firstSector = (unsigned long)entry->block * sectorsPerBlock;
+	for (unsigned int i = 0; i < sectorsPerBlock; i++)
+		if (diskReadSector(cacheDisk, firstSector + i, &entry->data[i * DISK_SECTORDATASIZE]) == -1)
+			return -1;
+	return 0;
+}
+
+// Retorna a entrada do bloco, reaproveitando a entrada nao fixada usada ha
+// mais tempo em caso de falta. Se load for 0, o conteudo nao e' lido do disco
+CacheEntry *__cacheGetEntry(unsigned int block, int load)
+{
+	if (cacheEntries == NULL)
+		return NULL;
+	CacheEntry *entry = __cacheLookup(block);
+	if (entry != NULL)
+	{
+		__cacheTouch(entry);
+		return entry;
+	}
+
+	entry = cacheLRUTail;
+	while (entry != NULL && entry->pinCount > 0)
+		entry = entry->prev;
+	if (entry == NULL)
+		return NULL;
+	if (entry->valid && entry->dirty && __cacheWriteBack(entry) == -1)
+		return NULL;
+	if (entry->valid)
+		__cacheHashRemove(entry);
+	entry->valid = 0;
+	entry->block = block;
+	if (load && __cacheLoad(entry) == -1)
+		return NULL;
+	entry->valid = 1;
+	entry->dirty = 0;
+	__cacheHashInsert(entry);
+	__cacheTouch(entry);
+	return entry;
+}
+
+int cacheInit(Disk *d, unsigned int blockSize, unsigned int memoryBudget)
+{
+	__cacheFree();
+	if (d == NULL || blockSize == 0 || blockSize % DISK_SECTORDATASIZE != 0)
+		return -1;
+	unsigned int numEntries = memoryBudget / blockSize;
+	if (numEntries < CACHE_MIN_BLOCKS)
+		numEntries = CACHE_MIN_BLOCKS;
+
+	cacheEntries = calloc(numEntries, sizeof(CacheEntry));
+	cacheData = malloc(numEntries * blockSize);
+	cacheHashSize = 2 * numEntries + 1;
+	cacheHash = calloc(cacheHashSize, sizeof(CacheEntry *));
+	if (cacheEntries == NULL || cacheData == NULL || cacheHash == NULL)
+	{
+		__cacheFree();
+		return -1;
+	}
+	for (unsigned int i = 0; i < numEntries; i++)
+	{
+		cacheEntries[i].data = &cacheData[i * blockSize];
+		cacheEntries[i].prev = i > 0 ? &cacheEntries[i - 1] : NULL;
+		cacheEntries[i].next = i + 1 < numEntries ? &cacheEntries[i + 1] : NULL;
+	}
+	cacheLRUHead = &cacheEntries[0];
+	cacheLRUTail = &cacheEntries[numEntries - 1];
+	cacheNumEntries = numEntries;
+	cacheBlockSize = blockSize;
+	cacheDisk = d;
+	return 0;
+}
+
+Disk *cacheGetDisk(void)
+{
+	return cacheDisk;
+}
+
+unsigned int cacheGetNumEntries(void)
+{
+	return cacheNumEntries;
+}
+
+int cacheRead(unsigned int block, unsigned char *buf)
+{
+	CacheEntry *entry = __cacheGetEntry(block, 1);
+	if (entry == NULL)
+		return -1;
+	memcpy(buf, entry->data, cacheBlockSize);
+	return 0;
+}
+
+int cacheWrite(unsigned int block, const unsigned char *buf, unsigned int size)
+{
+	if (size > cacheBlockSize)
+		size = cacheBlockSize;
+	CacheEntry *entry = __cacheGetEntry(block, 0);
+	if (entry == NULL)
+		return -1;
+	memcpy(entry->data, buf, size);
+	memset(&entry->data[size], 0, cacheBlockSize - size);
+	entry->dirty = 1;
+	return 0;
+}
+
+void cacheInvalidate(unsigned int block)
+{
+	CacheEntry *entry = cacheEntries != NULL ? __cacheLookup(block) : NULL;
+	if (entry == NULL || entry->pinCount > 0)
+		return;
+	__cacheHashRemove(entry);
+	entry->valid = 0;
+	entry->dirty = 0;
+	__cacheDemote(entry);
+}
+
+int cacheWriteDirect(unsigned int block, const unsigned char *buf)
+{
+	if (cacheEntries == NULL)
+		return -1;
+	CacheEntry *entry = __cacheLookup(block);
+	if (entry != NULL && entry->pinCount > 0)
+	{
+		memcpy(entry->data, buf, cacheBlockSize);
+		entry->dirty = 1;
+		return 0;
+	}
+	cacheInvalidate(block);
+	return __cacheWriteSectors(block, buf);
+}
+
+unsigned int cacheReadahead(unsigned int firstBlock, unsigned int numBlocks)
+{
+	unsigned int numCached = 0;
+	for (unsigned int i = 0; i < numBlocks; i++)
+	{
+		if (__cacheGetEntry(firstBlock + i, 1) == NULL)
+			break;
+		numCached++;
+	}
+	return numCached;
+}
+
+unsigned char *cachePin(unsigned int block, int load)
+{
+	CacheEntry *entry = __cacheGetEntry(block, load);
+	if (entry == NULL)
+		return NULL;
+	entry->pinCount++;
+	return entry->data;
+}
+
+void cacheUnpin(unsigned int block, int dirty)
+{
+	CacheEntry *entry = cacheEntries != NULL ? __cacheLookup(block) : NULL;
+	if (entry == NULL || entry->pinCount == 0)
+		return;
+	entry->pinCount--;
+	if (dirty)
+		entry->dirty = 1;
+}
+
+int __cacheCompareBlocks(const void *a, const void *b)
+{
+	unsigned int blockA = (*(CacheEntry **)a)->block;
+	unsigned int blockB = (*(CacheEntry **)b)->block;
+	return (blockA > blockB) - (blockA < blockB);
+}
+
+int cacheSync(void)
+{
+	if (cacheEntries == NULL)
+		return 0;
+	CacheEntry **dirtyEntries = malloc(cacheNumEntries * sizeof(CacheEntry *));
+	if (dirtyEntries == NULL)
+		return -1;
+	unsigned int numDirty = 0;
+	for (unsigned int i = 0; i < cacheNumEntries; i++)
+		if (cacheEntries[i].valid && cacheEntries[i].dirty)
+			dirtyEntries[numDirty++] = &cacheEntries[i];
+	// gravacao em ordem de endereco evita idas e vindas da cabeca do disco
+	qsort(dirtyEntries, numDirty, sizeof(CacheEntry *), __cacheCompareBlocks);
+	int ret = 0;
+	for (unsigned int i = 0; i < numDirty; i++)
+		if (__cacheWriteBack(dirtyEntries[i]) == -1)
+			ret = -1;
+	free(dirtyEntries);
+	return ret;
+}
@@ -0,0 +1,79 @@
+/*
+ *  cache.h - Cache de blocos (buffer cache) do sistema de arquivos MyFS
+ *
+ *  Autores: Willian Cesar de Sena Melo (Nº UFJF: 202035010)
+ *  Projeto: Trabalho Pratico II - Sistemas Operacionais
+ *  Organizacao: Universidade Federal de Juiz de Fora
+ *  Departamento: Dep. Ciencia da Computacao
+ *
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "disk.h"
+
+//Orcamento de memoria padrao do cache de blocos, em bytes. Pode ser
+//redefinido em tempo de compilacao (ex.: -DCACHE_MEMORY_BUDGET=1048576)
+#ifndef CACHE_MEMORY_BUDGET
+#define CACHE_MEMORY_BUDGET (256 * 1024)
+#endif
+
+//Numero minimo de blocos no cache, independente do orcamento de memoria
+#define CACHE_MIN_BLOCKS 8
+
+//Funcao que (re)inicializa o cache para o disco d, com blocos de blockSize
+//bytes e ocupacao limitada a memoryBudget bytes. O conteudo de um cache
+//anterior e' descartado sem ser gravado. Retorna 0 se bem sucedido ou -1
+//caso contrario
+int cacheInit (Disk *d, unsigned int blockSize, unsigned int memoryBudget);
+
+//Funcao que retorna o disco atendido pelo cache ou NULL se nao inicializado
+Disk* cacheGetDisk (void);
+
+//Funcao que retorna o numero de blocos que o cache comporta
+unsigned int cacheGetNumEntries (void);
+
+//Funcao que copia o conteudo do bloco block para buf, lendo-o do disco
+//apenas se nao estiver em cache. Retorna 0 se bem sucedido ou -1 caso
+//contrario
+int cacheRead (unsigned int block, unsigned char *buf);
+
+//Funcao que substitui o conteudo do bloco block pelos size primeiros bytes
+//de buf, completando o restante com zeros. O bloco e' apenas marcado como
+//sujo; a gravacao em disco ocorre na substituicao ou em cacheSync. Retorna
+//0 se bem sucedido ou -1 caso contrario
+int cacheWrite (unsigned int block, const unsigned char *buf,
+                unsigned int size);
+
+//Funcao que grava o bloco block inteiro diretamente a partir de buf, sem
+//copia-lo para o cache. Uma copia do bloco em cache e' descartada ou, se
+//estiver fixada, atualizada. Retorna 0 se bem sucedido ou -1 caso contrario
+int cacheWriteDirect (unsigned int block, const unsigned char *buf);
+
+//Funcao que descarta a copia em cache do bloco block, sem grava-la, pois o
+//bloco foi liberado e seu conteudo nao interessa mais. Blocos fixados sao
+//mantidos
+void cacheInvalidate (unsigned int block);
+
+//Funcao que carrega no cache os numBlocks blocos consecutivos em disco a
+//partir de firstBlock que ainda nao estejam em cache, em ordem crescente de
+//endereco, de modo que a leitura nao exija reposicionamento da cabeca entre
+//os blocos. Retorna o numero de blocos presentes no cache ao final
+unsigned int cacheReadahead (unsigned int firstBlock, unsigned int numBlocks);
+
+//Funcao que fixa o bloco block no cache e retorna o endereco de seus dados,
+//que permanece valido ate a chamada de cacheUnpin. Se load for 0, o bloco
+//nao e' lido do disco, pois o chamador ira sobrescreve-lo por inteiro.
+//Retorna NULL se nao houver memoria ou todos os blocos estiverem fixados
+unsigned char* cachePin (unsigned int block, int load);
+
+//Funcao que libera um bloco fixado por cachePin. Se dirty for diferente de
+//0, o bloco e' marcado como modificado
+void cacheUnpin (unsigned int block, int dirty);
+
+//Funcao que grava em disco todos os blocos modificados, em ordem crescente
+//de endereco. Retorna 0 se bem sucedido ou -1 caso contrario
+int cacheSync (void);
+
+#endif
@@ -6,7 +6,7 @@
 *  Organizacao: Universidade Federal de Juiz de Fora
 *  Departamento: Dep. Ciencia da Computacao
 *
-*  => NAO MODIFIQUE ESTE ARQUIVO <=
+*  Fornecido com o enunciado; estendido e mantido junto com o MyFS
 *
 */
 
@@ -24,9 +24,19 @@
 #define INODE_ITEM_GROUPOWNER (INODE_SIZE - 5)	//Item 11: Grupo Proprietario
 #define INODE_ITEM_PERMISSION (INODE_SIZE - 4)	//Item 12: Permissao
 #define INODE_ITEM_REFCOUNT (INODE_SIZE - 3)	//Item 13: Contador referencia
+#define INODE_ITEM_FILESIZEHIGH (NUMBLOCKS_PERINODE - 1) //Item 7 (layout com
+				//tamanho de 64 bits): 32 bits mais altos do tamanho
 
 #define INODE_BEGINSECTOR 2
 
+//Numero de i-nodes da area de i-nodes do disco (0: nao informado)
+unsigned int inodeAreaNumInodes = 0;
+
+//Layout dos i-nodes do disco e numero de enderecos de bloco no primeiro
+//i-node da cadeia, que depende do layout
+unsigned int inodeLayout = INODE_LAYOUT_32BIT_SIZE;
+unsigned int inodeNumDirectBlocks = NUMBLOCKS_PERINODE;
+
 //Tipo para representacao de i-nodes
 struct inode {
 	unsigned int inodeItem[NUMITEMS_PERINODE]; //Blocos e dados do i-node
@@ -55,6 +65,41 @@ Inode* __inodeGetLastExtension (Inode *i) {
 	return i;
 }
 
+//Funcao interna que retorna o endereco do setor onde fica o i-node de numero
+//number
+unsigned long int __inodeSectorAddr (unsigned int number) {
+	return INODE_BEGINSECTOR + (number - 1) * INODE_SIZE
+		* sizeof(unsigned int) / DISK_SECTORDATASIZE;
+}
+
+//Funcao interna que retorna a posicao de inicio do i-node de numero number
+//dentro de seu setor
+unsigned long int __inodeSectorOffset (unsigned int number) {
+	unsigned long int sizeUInt = sizeof(unsigned int);
+	return ((number - 1) % (DISK_SECTORDATASIZE / (INODE_SIZE * sizeUInt)))
+		* INODE_SIZE * sizeUInt;
+}
+
+//Funcao interna que copia o i-node para sua posicao no setor
+void __inodeEncode (Inode *i, unsigned char *sector) {
+	unsigned long int sizeUInt = sizeof(unsigned int);
+	unsigned long int offset = __inodeSectorOffset (i->number);
+	for (int a=0; a < NUMITEMS_PERINODE; a++)
+		ul2char (i->inodeItem[a], &sector[offset+a*sizeUInt]);
+	ul2char (i->number, &sector[offset+(INODE_SIZE-2)*sizeUInt]);
+	ul2char (i->next, &sector[offset+(INODE_SIZE-1)*sizeUInt]);
+}
+
+//Funcao interna que le do setor o i-node de numero number
+void __inodeDecode (Inode *i, unsigned int number, unsigned char *sector) {
+	unsigned long int sizeUInt = sizeof(unsigned int);
+	unsigned long int offset = __inodeSectorOffset (number);
+	for (int a=0; a < NUMITEMS_PERINODE; a++)
+		char2ul (&sector[offset+a*sizeUInt], &(i->inodeItem[a]));
+	char2ul (&sector[offset+(INODE_SIZE-2)*sizeUInt], &(i->number));
+	char2ul (&sector[offset+(INODE_SIZE-1)*sizeUInt], &(i->next));
+}
+
 //Funcao que retorna o numero de i-nodes por setor
 unsigned int inodeNumInodesPerSector ( void ) {
 	return DISK_SECTORDATASIZE / (INODE_SIZE * sizeof (unsigned int));
@@ -65,6 +110,32 @@ unsigned int inodeAreaBeginSector ( void ) {
 	return INODE_BEGINSECTOR;
 }
 
+//Funcao que retorna o numero de enderecos de bloco de uma extensao de i-node
+unsigned int inodeNumItemsPerExtension ( void ) {
+	return NUMITEMS_PERINODE;
+}
+
+//Funcao que informa o numero de i-nodes da area de i-nodes do disco, de modo
+//que a busca por i-nodes livres nao ultrapasse essa area
+void inodeSetAreaNumInodes (unsigned int numInodes) {
+	inodeAreaNumInodes = numInodes;
+}
+
+//Funcao que define o layout dos i-nodes do disco (INODE_LAYOUT_*). No layout
+//com tamanho de 64 bits, o ultimo endereco de bloco do primeiro i-node da
+//cadeia guarda os 32 bits mais altos do tamanho do arquivo
+void inodeSetLayout (unsigned int layout) {
+	inodeLayout = layout;
+	inodeNumDirectBlocks = (layout == INODE_LAYOUT_64BIT_SIZE ?
+	                        NUMBLOCKS_PERINODE - 1 : NUMBLOCKS_PERINODE);
+}
+
+//Funcao que retorna o maior tamanho de arquivo representavel no layout atual
+unsigned long long inodeMaxFileSize ( void ) {
+	if (inodeLayout == INODE_LAYOUT_64BIT_SIZE) return ~0ULL;
+	return ~0U;
+}
+
 //Funcao que cria um i-node vazio, identificado pelo seu numero (number),
 //que deve ser unico no sistema de arquivos. Retorna ponteiro para o i-node
 //criado ou NULL se nao houver memoria suficiente ou number invalido. A funcao
@@ -109,29 +180,15 @@ int inodeClear (Inode *i) {
 //cada setor pode receber 8 i-nodes 
 int inodeSave (Inode *i) {
 	if (i) {
-		unsigned long int sizeUInt = sizeof(unsigned int);
 		//Endereco do setor no qual o i-node sera' salvo
-		unsigned long int inodeSectorAddr = 
-			INODE_BEGINSECTOR + (i->number - 1) * INODE_SIZE 
-			* sizeUInt / DISK_SECTORDATASIZE;
+		unsigned long int inodeSectorAddr = __inodeSectorAddr (i->number);
 		unsigned char sector[DISK_SECTORDATASIZE];
 
 		int ret = diskReadSector (i->d, inodeSectorAddr, sector);
 		if (ret < 0) return ret;
 
-		//Posicao de inicio do i-node dentro do setor
-		unsigned long int offset = ((i->number - 1) % 
-			   (DISK_SECTORDATASIZE / (INODE_SIZE * sizeUInt)))
-                           * INODE_SIZE * sizeUInt;
-
 		//Alterando enderecos de blocos e atributos do i-node no setor
-		for (int a=0; a < NUMITEMS_PERINODE; a++)
-			ul2char (i->inodeItem[a], 
-			         &sector[offset+a*sizeUInt]);
-		ul2char (i->number, 
-		         &sector[offset+(INODE_SIZE-2)*sizeUInt]);
-		ul2char (i->next, 
-			 &sector[offset+(INODE_SIZE-1)*sizeUInt]);
+		__inodeEncode (i, sector);
 
 		//Salvando todo o setor onde se encontra o i-node...
 		ret = diskWriteSector (i->d, inodeSectorAddr, sector);
@@ -143,45 +200,52 @@ int inodeSave (Inode *i) {
 //Funcao que recupera um i-node a partir do disco. Retorna ponteiro para o
 //i-node lido ou NULL em caso de falha.
 Inode* inodeLoad (unsigned int number, Disk *d) {
-	unsigned long int sizeUInt = sizeof(unsigned int);
 	//Endereco do setor do qual o i-node sera' lido
-	unsigned long int inodeSectorAddr = 
-		INODE_BEGINSECTOR + (number - 1) * INODE_SIZE * sizeUInt
-		    / DISK_SECTORDATASIZE;
+	unsigned long int inodeSectorAddr = __inodeSectorAddr (number);
 	unsigned char sector[DISK_SECTORDATASIZE];
 	Inode *i = NULL;
 
 	int ret = diskReadSector (d, inodeSectorAddr, sector);
 	if (ret < 0) return NULL;
 
-	//Posicao de inicio do i-node dentro do setor
-	unsigned long int offset = ((number - 1) % 
-		(DISK_SECTORDATASIZE / (INODE_SIZE * sizeUInt)))
-		* INODE_SIZE * sizeUInt;
-
 	i = malloc (sizeof(Inode));
 	if (i) {
 		i->d = d;
 		//Recuperando enderecos de blocos e atributos do i-node no setor
-		for (int a=0; a < NUMITEMS_PERINODE; a++)
-			char2ul (&sector[offset+a*sizeUInt],
-			         &(i->inodeItem[a]));
-		char2ul (&sector[offset+(INODE_SIZE-2)*sizeUInt],
-		         &(i->number));
-		char2ul (&sector[offset+(INODE_SIZE-1)*sizeUInt],
-		         &(i->next));
+		__inodeDecode (i, number, sector);
 	}
 	return i;
 }
 
+//Funcao que persiste count i-nodes em seu disco. I-nodes consecutivos do
+//vetor que ficam no mesmo setor sao gravados juntos, com uma unica leitura e
+//uma unica gravacao do setor. Retorna 0 se bem sucedido ou -1 caso contrario
+int inodeSaveMany (Inode **inodes, unsigned int count) {
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned int a = 0;
+	while (a < count) {
+		Disk *d = inodes[a]->d;
+		unsigned long int inodeSectorAddr = __inodeSectorAddr (inodes[a]->number);
+		if (diskReadSector (d, inodeSectorAddr, sector) < 0) return -1;
+		for (; a < count && inodes[a]->d == d &&
+		       __inodeSectorAddr (inodes[a]->number) == inodeSectorAddr; a++)
+			__inodeEncode (inodes[a], sector);
+		if (diskWriteSector (d, inodeSectorAddr, sector) < 0) return -1;
+	}
+	return 0;
+}
+
 //Funcao que modifica o tipo de arquivo referente a um i-node
 void inodeSetFileType (Inode *i, unsigned int fileType) {
 	if (i) i->inodeItem[INODE_ITEM_FILETYPE] = fileType;
 }
 
 //Funcao que modifica o tamanho do arquivo referente a um i-node, em bytes
-void inodeSetFileSize (Inode *i, unsigned int fileSize) {
-	if (i) i->inodeItem[INODE_ITEM_FILESIZE] = fileSize;
+void inodeSetFileSize (Inode *i, unsigned long long fileSize) {
+	if (!i) return;
+	i->inodeItem[INODE_ITEM_FILESIZE] = (unsigned int) fileSize;
+	if (inodeLayout == INODE_LAYOUT_64BIT_SIZE)
+		i->inodeItem[INODE_ITEM_FILESIZEHIGH] = (unsigned int) (fileSize >> 32);
 }
 
 //Funcao que modifica o proprietario do arquivo referente a um i-node
@@ -212,7 +276,8 @@ int inodeAddBlock (Inode *i, unsigned int blockAddr) {
 		Disk *d = i->d;
 		Inode* lastInodeExt = NULL;
 		unsigned int niNumber;
-		int ret, numblocks = NUMBLOCKS_PERINODE;
+		int ret;
+		unsigned int numblocks = inodeNumDirectBlocks;
 		lastInodeExt = __inodeGetLastExtension (i);
 		if (lastInodeExt) {
 			numblocks = NUMITEMS_PERINODE;
@@ -221,12 +286,12 @@ int inodeAddBlock (Inode *i, unsigned int blockAddr) {
 		else if (i->next != 0) return -1;
 		else lastInodeExt = i;
 
-		for (int a = 0; a < numblocks; a++)
+		for (unsigned int a = 0; a < numblocks; a++)
 			//Encontrar bloco sem endereco
 			if (lastInodeExt->inodeItem[a] == 0) {
 				lastInodeExt->inodeItem[a] = blockAddr;
 				ret = inodeSave(lastInodeExt);
-				if (numblocks != NUMBLOCKS_PERINODE) 
+				if (numblocks != inodeNumDirectBlocks) 
 					free (lastInodeExt);
 				return ret;
 			}
@@ -235,12 +300,12 @@ int inodeAddBlock (Inode *i, unsigned int blockAddr) {
 		if (niNumber) {
 			lastInodeExt->next = niNumber;
 			ret = inodeSave (lastInodeExt);
-			if (numblocks != NUMBLOCKS_PERINODE) 
+			if (numblocks != inodeNumDirectBlocks) 
 				free (lastInodeExt);
 			if (ret < 0) return ret;
 		}
 		else {
-			if (numblocks != NUMBLOCKS_PERINODE)
+			if (numblocks != inodeNumDirectBlocks)
 				free (lastInodeExt);
 			return -1;
 		}
@@ -254,6 +319,204 @@ int inodeAddBlock (Inode *i, unsigned int blockAddr) {
 	return -1;
 }
 
+//Funcao que define o endereco do bloco de indice blockNum no array de blocos
+//de um i-node, criando as extensoes necessarias. Indices intermediarios sem
+//endereco permanecem como buracos (endereco 0). O i-node precisa ser o
+//primeiro de sua cadeia. Salva em disco os i-nodes alterados. Retorna 0 se
+//bem sucedido ou -1 caso contrario
+int inodeSetBlockAddr (Inode *i, unsigned int blockNum, unsigned int blockAddr) {
+	if (!i) return -1;
+	if (blockNum < inodeNumDirectBlocks) {
+		i->inodeItem[blockNum] = blockAddr;
+		return inodeSave (i);
+	}
+	unsigned int extNum = 1 + (blockNum - inodeNumDirectBlocks) / NUMITEMS_PERINODE;
+	unsigned int offset = (blockNum - inodeNumDirectBlocks) % NUMITEMS_PERINODE;
+	Inode *prev = i, *ni = NULL;
+	int ret;
+	for (unsigned int a = 1; a <= extNum; a++) {
+		unsigned int niNumber = prev->next;
+		if (niNumber == 0) {
+			//Um buraco alem do fim da cadeia ja e' um buraco
+			if (blockAddr == 0) {
+				if (prev != i) free (prev);
+				return 0;
+			}
+			//A busca comeca apos prev, que pode ser uma extensao recem
+			//criada e ainda vazia, portanto com aparencia de livre
+			niNumber = inodeFindFreeInode (prev->number + 1, i->d);
+			if (niNumber == 0 || niNumber == prev->number) {
+				if (prev != i) free (prev);
+				return -1;
+			}
+			ni = inodeCreate (niNumber, i->d);
+			prev->next = niNumber;
+			if (!ni || inodeSave (prev) < 0) {
+				if (prev != i) free (prev);
+				if (ni) free (ni);
+				return -1;
+			}
+		}
+		else {
+			ni = inodeLoad (niNumber, i->d);
+			if (!ni) {
+				if (prev != i) free (prev);
+				return -1;
+			}
+		}
+		if (prev != i) free (prev);
+		prev = ni;
+	}
+	ni->inodeItem[offset] = blockAddr;
+	ret = inodeSave (ni);
+	free (ni);
+	return ret;
+}
+
+//Funcao que define os enderecos dos numBlocks blocos a partir de firstBlock
+//no array de blocos de um i-node, copiando-os de addrs. A cadeia de extensoes
+//e' percorrida uma unica vez, criando as extensoes necessarias, e cada
+//extensao alterada e' salva uma unica vez. O i-node precisa ser o primeiro de
+//sua cadeia e nao e' salvo, cabendo ao chamador grava-lo. Retorna 0 se bem
+//sucedido ou -1 caso contrario
+int inodeSetBlockAddrs (Inode *i, unsigned int firstBlock,
+                        unsigned int numBlocks, unsigned int *addrs) {
+	unsigned int done = 0, blockNum = firstBlock;
+	unsigned int niFirstBlock = inodeNumDirectBlocks;
+	Inode *prev = i, *ni = NULL;
+	int prevChanged = 0, ret = 0;
+	if (!i) return -1;
+	for (; blockNum < inodeNumDirectBlocks && done < numBlocks; blockNum++)
+		i->inodeItem[blockNum] = addrs[done++];
+	while (done < numBlocks) {
+		unsigned int niNumber = prev->next;
+		if (niNumber == 0) {
+			//Como em inodeSetBlockAddr, a busca comeca apos prev, que pode
+			//ser uma extensao recem criada e ainda nao salva
+			niNumber = inodeFindFreeInode (prev->number + 1, i->d);
+			ni = (niNumber == 0 || niNumber == prev->number ||
+			      niNumber == i->number) ? NULL : inodeCreate (niNumber, i->d);
+			if (ni) {
+				prev->next = niNumber;
+				prevChanged = 1;
+			}
+		}
+		else ni = inodeLoad (niNumber, i->d);
+		//A extensao anterior nao muda mais e pode ser salva
+		if (prev != i) {
+			if (prevChanged && inodeSave (prev) < 0) ret = -1;
+			free (prev);
+		}
+		prev = ni;
+		prevChanged = 0;
+		if (!ni || ret < 0) break;
+		for (; blockNum < niFirstBlock + NUMITEMS_PERINODE && done < numBlocks; blockNum++) {
+			ni->inodeItem[blockNum - niFirstBlock] = addrs[done++];
+			prevChanged = 1;
+		}
+		niFirstBlock += NUMITEMS_PERINODE;
+	}
+	if (prev && prev != i) {
+		if (prevChanged && inodeSave (prev) < 0) ret = -1;
+		free (prev);
+	}
+	if (!prev) ret = -1;
+	return ret;
+}
+
+//Funcao que retorna o numero de posicoes do array de blocos de um i-node ate
+//o ultimo bloco com endereco, inclusive. Buracos anteriores sao contados.
+//O i-node precisa ser o primeiro de sua cadeia
+unsigned int inodeGetBlockCount (Inode *i) {
+	unsigned int count = 0, base = inodeNumDirectBlocks;
+	if (!i) return 0;
+	for (unsigned int a = 0; a < inodeNumDirectBlocks; a++)
+		if (i->inodeItem[a] != 0) count = a + 1;
+	unsigned int niNumber = i->next;
+	while (niNumber != 0) {
+		Inode *ni = inodeLoad (niNumber, i->d);
+		if (!ni) break;
+		for (int a = 0; a < NUMITEMS_PERINODE; a++)
+			if (ni->inodeItem[a] != 0) count = base + a + 1;
+		niNumber = ni->next;
+		base += NUMITEMS_PERINODE;
+		free (ni);
+	}
+	return count;
+}
+
+//Funcao que desliga de um i-node os blocos de indice numBlocks em diante,
+//sem percorrer a parte desligada. A cadeia e' cortada apos o ultimo i-node
+//que mantem algum endereco; os enderecos desligados desse i-node sao
+//copiados para blockAddrs, que deve comportar inodeNumItemsPerExtension()
+//enderecos, e o numero da primeira extensao desligada, com sua cadeia
+//intacta, e' retornado em detachedChain (0 se nenhuma). O i-node precisa ser
+//o primeiro de sua cadeia. Retorna o numero de enderecos copiados ou -1 em
+//caso de falha
+int inodeTruncateBlocks (Inode *i, unsigned int numBlocks, unsigned int *blockAddrs,
+                         unsigned int *detachedChain) {
+	if (!i || !blockAddrs || !detachedChain) return -1;
+	Inode *cur = i, *keep = i;
+	unsigned int base = 0, count = inodeNumDirectBlocks;
+	unsigned int keepBase = 0, keepCount = inodeNumDirectBlocks;
+	while (1) {
+		int hasKept = 0;
+		for (unsigned int a = 0; a < count && base + a < numBlocks; a++)
+			if (cur->inodeItem[a] != 0) hasKept = 1;
+		unsigned int niNumber = cur->next;
+		if (hasKept && cur != keep) {
+			if (keep != i) free (keep);
+			keep = cur;
+			keepBase = base;
+			keepCount = count;
+		}
+		else if (cur != keep) free (cur);
+		base += count;
+		count = NUMITEMS_PERINODE;
+		if (base >= numBlocks || niNumber == 0) break;
+		cur = inodeLoad (niNumber, i->d);
+		if (!cur) {
+			if (keep != i) free (keep);
+			return -1;
+		}
+	}
+	int numAddrs = 0;
+	for (unsigned int a = 0; a < keepCount; a++) {
+		if (keepBase + a >= numBlocks && keep->inodeItem[a] != 0) {
+			blockAddrs[numAddrs++] = keep->inodeItem[a];
+			keep->inodeItem[a] = 0;
+		}
+	}
+	*detachedChain = keep->next;
+	keep->next = 0;
+	int ret = inodeSave (keep);
+	if (keep != i) free (keep);
+	return ret < 0 ? -1 : numAddrs;
+}
+
+//Funcao que libera a extensao de i-node de numero number, zerando-a em disco.
+//Os enderecos de bloco nao nulos da extensao sao copiados para blockAddrs,
+//que deve comportar inodeNumItemsPerExtension() enderecos, e o numero da
+//extensao seguinte e' retornado em next. Retorna o numero de enderecos
+//copiados ou -1 em caso de falha
+int inodeReleaseExtension (unsigned int number, Disk *d, unsigned int *blockAddrs,
+                           unsigned int *next) {
+	if (!blockAddrs || !next) return -1;
+	Inode *i = inodeLoad (number, d);
+	if (!i) return -1;
+	int numAddrs = 0;
+	for (int a = 0; a < NUMITEMS_PERINODE; a++) {
+		if (i->inodeItem[a] != 0)
+			blockAddrs[numAddrs++] = i->inodeItem[a];
+		i->inodeItem[a] = 0;
+	}
+	*next = i->next;
+	i->next = 0;
+	int ret = inodeSave (i);
+	free (i);
+	return ret < 0 ? -1 : numAddrs;
+}
+
 //Funcao que retorna o numero de um i-node.
 unsigned int inodeGetNumber (Inode *i) {
 	return (i ? i->number : 0);
@@ -271,8 +534,12 @@ unsigned int inodeGetFileType (Inode *i) {
 }
 
 //Funcao que retorna o tamanho do arquivo referente ao i-node, em bytes
-unsigned int inodeGetFileSize (Inode *i) {
-	return (i ? i->inodeItem[INODE_ITEM_FILESIZE] : 0);
+unsigned long long inodeGetFileSize (Inode *i) {
+	if (!i) return 0;
+	unsigned long long fileSize = i->inodeItem[INODE_ITEM_FILESIZE];
+	if (inodeLayout == INODE_LAYOUT_64BIT_SIZE)
+		fileSize |= (unsigned long long) i->inodeItem[INODE_ITEM_FILESIZEHIGH] << 32;
+	return fileSize;
 }
 
 
@@ -303,41 +570,136 @@ unsigned int inodeGetRefCount (Inode *i) {
 //de blocos de um i-node. O i-node precisa ser o primeiro de sua cadeia.
 //Retorna 0 se o bloco nao possuir endereco em blockNum
 unsigned int inodeGetBlockAddr (Inode *i, unsigned int blockNum) {
-	unsigned int numblocks = NUMBLOCKS_PERINODE;
 	if (i) {
-		if (blockNum < NUMBLOCKS_PERINODE)
+		if (blockNum < inodeNumDirectBlocks)
 			return i->inodeItem[blockNum];
 		else {
 			unsigned int extNum = 1 + 
-			                      (blockNum - NUMBLOCKS_PERINODE) 
+			                      (blockNum - inodeNumDirectBlocks) 
 			                      / NUMITEMS_PERINODE;
-			unsigned int offset = (blockNum - NUMBLOCKS_PERINODE)
+			unsigned int offset = (blockNum - inodeNumDirectBlocks)
 			                      % NUMITEMS_PERINODE;
+			unsigned int addr;
+			if (i->next == 0) return 0;
 			Inode *ni = inodeLoad (i->next, i->d);
-			for (int a = 1; a < extNum; a++) {
+			for (unsigned int a = 1; a < extNum && ni; a++) {
 				Disk *d = ni->d;
 				unsigned int niNumber = ni->next;
 				free (ni);
-				ni = inodeLoad (niNumber, d);
+				ni = (niNumber ? inodeLoad (niNumber, d) : NULL);
 			}
-			return ni->inodeItem[offset];
+			if (!ni) return 0;
+			addr = ni->inodeItem[offset];
+			free (ni);
+			return addr;
 		}
 	}
 	return 0;
 }
 
+//Funcao que copia para addrs os enderecos dos numBlocks blocos a partir de
+//firstBlock no array de blocos de um i-node, percorrendo a cadeia de
+//extensoes uma unica vez. O i-node precisa ser o primeiro de sua cadeia.
+//Blocos sem endereco sao copiados como 0. Retorna o numero de enderecos
+//copiados antes do fim da cadeia
+unsigned int inodeGetBlockAddrs (Inode *i, unsigned int firstBlock,
+                                 unsigned int numBlocks, unsigned int *addrs) {
+	unsigned int copied = 0, blockNum = firstBlock;
+	Inode *ni = NULL;
+	unsigned int niFirstBlock = inodeNumDirectBlocks;
+	if (!i) return 0;
+	for (; blockNum < inodeNumDirectBlocks && copied < numBlocks; blockNum++)
+		addrs[copied++] = i->inodeItem[blockNum];
+	if (copied == numBlocks || i->next == 0) return copied;
+	ni = inodeLoad (i->next, i->d);
+	while (ni && copied < numBlocks) {
+		if (blockNum < niFirstBlock + NUMITEMS_PERINODE) {
+			addrs[copied++] = ni->inodeItem[blockNum - niFirstBlock];
+			blockNum++;
+		}
+		else {
+			unsigned int niNumber = ni->next;
+			Disk *d = ni->d;
+			free (ni);
+			ni = (niNumber ? inodeLoad (niNumber, d) : NULL);
+			niFirstBlock += NUMITEMS_PERINODE;
+		}
+	}
+	if (ni) free (ni);
+	return copied;
+}
+
+//Funcao que retorna o numero de i-nodes (o primeiro da cadeia e suas
+//extensoes) necessarios para enderecar numBlocks blocos
+unsigned int inodeNumInodesForBlocks (unsigned int numBlocks) {
+	if (numBlocks == 0) return 0;
+	if (numBlocks <= inodeNumDirectBlocks) return 1;
+	return 1 + (numBlocks - inodeNumDirectBlocks + NUMITEMS_PERINODE - 1)
+	           / NUMITEMS_PERINODE;
+}
+
+//Funcao que indica se um i-node esta livre, ou seja, sem nenhum endereco de
+//bloco, atributo ou extensao. Como blocos podem ser buracos (endereco 0), o
+//primeiro endereco sozinho nao basta. Retorna 1 se livre ou 0 caso contrario
+int inodeIsFree (Inode *i) {
+	if (!i || i->next != 0) return 0;
+	for (int a = 0; a < NUMITEMS_PERINODE; a++)
+		if (i->inodeItem[a] != 0) return 0;
+	return 1;
+}
+
 //Funcao que encontra um i-node livre em um disco, a partir do i-node de numero
-//startFrom. Retorna o numero do inode livre encontrado ou 0 se nao encontrado.
+//startFrom. Se o numero de i-nodes da area foi informado, a busca recomeca do
+//inicio da area ao atingir seu fim. Retorna o numero do inode livre
+//encontrado ou 0 se nao encontrado.
 unsigned int inodeFindFreeInode (unsigned int startFrom, Disk *d) {
 	Inode *i = NULL;
 	unsigned int number = 0;
 	if (startFrom < 1) return 0;
+	if (inodeAreaNumInodes && startFrom > inodeAreaNumInodes) startFrom = 1;
 	for (unsigned int a = startFrom; number == 0; a++) {
+		if (inodeAreaNumInodes && a > inodeAreaNumInodes) a = 1;
 		i = inodeLoad (a, d);
 		if (!i) break;
-		if (inodeGetBlockAddr(i, 0) == 0)
+		if (inodeIsFree(i))
 			number = inodeGetNumber(i);
 		free (i);
+		if (inodeAreaNumInodes && a % inodeAreaNumInodes + 1 == startFrom)
+			break;
 	}
 	return number;
 }
+
+//Funcao que encontra ate count i-nodes livres em um disco, a partir do i-node
+//de numero startFrom, lendo cada setor da area de i-nodes uma unica vez. Os
+//i-nodes encontrados sao carregados em memoria, em ordem, em inodes. Como em
+//inodeFindFreeInode, a busca recomeca do inicio da area ao atingir seu fim.
+//Retorna o numero de i-nodes encontrados
+unsigned int inodeFindFreeInodes (unsigned int startFrom, unsigned int count,
+                                  Inode **inodes, Disk *d) {
+	unsigned char sector[DISK_SECTORDATASIZE];
+	unsigned long int loadedSector = 0; //Setor em sector (0: nenhum)
+	unsigned int found = 0;
+	if (startFrom < 1) return 0;
+	if (inodeAreaNumInodes && startFrom > inodeAreaNumInodes) startFrom = 1;
+	for (unsigned int a = startFrom; found < count; a++) {
+		if (inodeAreaNumInodes && a > inodeAreaNumInodes) a = 1;
+		unsigned long int inodeSectorAddr = __inodeSectorAddr (a);
+		if (inodeSectorAddr != loadedSector) {
+			if (diskReadSector (d, inodeSectorAddr, sector) < 0) break;
+			loadedSector = inodeSectorAddr;
+		}
+		Inode *i = malloc (sizeof(Inode));
+		if (!i) break;
+		i->d = d;
+		__inodeDecode (i, a, sector);
+		i->number = a;
+		if (inodeIsFree(i))
+			inodes[found++] = i;
+		else
+			free (i);
+		if (inodeAreaNumInodes && a % inodeAreaNumInodes + 1 == startFrom)
+			break;
+	}
+	return found;
+}
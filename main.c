@@ -468,17 +468,17 @@ void doDirList (void) {
 	if ( !rd )
 		printf ("\n!! DirList: FAILED. No root filesystem mounted!\n");
 	else {
-		int fd, res;
-		char entryname[MAX_FILENAME_LENGTH+1];
-		unsigned int inumber;
+		int fd, res, i;
+		FSDirent entries[16];
 		printf ("\n>> DirList: Directory descriptor (#): ");
 		scanf (" %u", &fd);
 		printf ("\n-- DirList: Listing...\n"); fflush (stdout);
-		res = vfsReaddir (fd, entryname, &inumber);
+		res = vfsGetdents (fd, entries, 16);
 		while ( res > 0 ) {
-			printf ("-- Inode #: %5d     Name: %s\n",
-			        inumber, entryname);
-			res = vfsReaddir (fd, entryname, &inumber);
+			for ( i = 0; i < res; i++ )
+				printf ("-- Inode #: %5d     Name: %s\n",
+				        entries[i].inumber, entries[i].name);
+			res = vfsGetdents (fd, entries, 16);
 		}
 		if ( res == -1 )
 			printf ("\n!! DirList: FAILED. Invalid file "
@@ -11,12 +11,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "myfs.h"
 #include "vfs.h"
 #include "inode.h"
+#include "cache.h"
 #include "util.h"
 
-unsigned int divideCeil(unsigned int a, unsigned int b)
+unsigned int divideCeil(unsigned long long a, unsigned int b)
 {
 	unsigned int result = a / b;
 	if (a % b != 0)
@@ -29,91 +31,200 @@ unsigned int divideCeil(unsigned int a, unsigned int b)
 #define NUMBLOCKS_PERINODE 8
 
 #define ROOT_INODE_NUMBER 1
-Inode *inodeRoot = NULL;
-int loadRootInode(Disk *d)
-{
-	if (inodeRoot != NULL)
-		return 0;
-	inodeRoot = inodeLoad(ROOT_INODE_NUMBER, d);
-	if (inodeRoot == NULL)
-		return -1;
-	return 0;
-}
 
 // superbloco
 #define SUPERBLOCK_SECTOR 0
-#define SUPERBLOCK_SIZE 4 // Tamanho do superbloco em numero de unsigned ints
+#define SUPERBLOCK_SIZE 7 // Tamanho do superbloco em numero de unsigned ints
 #define SUPERBLOCK_ITEM_BLOCKSIZE 0
 #define SUPERBLOCK_ITEM_NUMBLOCKS 1
 #define SUPERBLOCK_ITEM_NUMINODES 2
 #define SUPERBLOCK_ITEM_BITMAPBLOCK 3
+#define SUPERBLOCK_ITEM_FREEBLOCKS 4 // mantido por setBlocksStatus
+#define SUPERBLOCK_ITEM_FREEINODES 5 // mantido por claimInode, setInodeBlock e releaseInode
+#define SUPERBLOCK_ITEM_LAYOUT 6	 // SUPERBLOCK_LAYOUT_64BIT ou, em discos antigos, 0
+// discos com tamanhos de 64 bits nos i-nodes e bitmap em varios blocos; o
+// valor e' uma assinatura para nao ser confundido com lixo de discos antigos
+#define SUPERBLOCK_LAYOUT_64BIT 0x4D594632
 unsigned int *superblock = NULL;
 
 // bitmap
 #define BITMAP_SECTOR 1
 unsigned char *bitmap = NULL; // tamanho = numero de blocos | 1 = ocupado, 0 = livre
+// o bitmap ocupa blocos consecutivos a partir de SUPERBLOCK_ITEM_BITMAPBLOCK;
+// apenas os blocos com entradas alteradas em [from, to) sao regravados
+unsigned int bitmapDirtyFrom = 0;
+unsigned int bitmapDirtyTo = 0;
+
+// alocacao postergada: blocos escritos alem do fim do arquivo ficam em memoria
+// e so recebem endereco fisico no flush (close ou buffer cheio)
+#define MAX_DELAYED_BLOCKS 64
+unsigned int reservedBlocks = 0; // blocos prometidos a buffers de alocacao postergada
+unsigned int reservedInodes = 0; // i-nodes prometidos para enderecar esses blocos
+
+// leitura antecipada: a janela comeca em READAHEAD_MIN_BLOCKS apos a primeira
+// leitura sequencial e dobra a cada nova leitura sequencial, ate o maximo
+#define READAHEAD_MIN_BLOCKS 4
+#define READAHEAD_MAX_BLOCKS 32
+
+// copia entre arquivos (myFSCopyRange): blocos transferidos por iteracao
+#define COPY_CHUNK_BLOCKS 64
+
+// recuperacao postergada de espaco: blocos e cadeias de extensoes desligados
+// de i-nodes ficam em fila, ainda ocupados no bitmap, e so sao liberados em
+// reclaimSpace (sync, sistema ocioso ou falta de espaco)
+#define RECLAIM_ALL ((unsigned int)-1)
+#define RECLAIM_IDLE_EXTENSIONS 16 // extensoes liberadas por passada em ociosidade
+typedef struct reclaimQueue
+{
+	unsigned int *blocks; // blocos a devolver ao bitmap
+	unsigned int numBlocks;
+	unsigned int *chains; // primeira extensao de cada cadeia desligada
+	unsigned int numChains;
+} ReclaimQueue;
+ReclaimQueue reclaimQueue = {NULL, 0, NULL, 0};
 
 #define MAX_OPEN_FILES MAX_FDS
-typedef struct fileDescriptor
+// i-nodes abertos: uma unica copia em memoria por numero de i-node,
+// compartilhada pelos descritores do arquivo e pelos usos internos (ex.:
+// travessia de caminhos), para que tamanho, blocos e alocacao postergada
+// sejam vistos de forma coerente por todos
+#define OPEN_INODE_HASH_SIZE 64
+typedef struct openInode
 {
-	unsigned int fd;
 	Inode *inode;
 	Disk *disk;
-	unsigned int cursor;
+	unsigned int refs;				 // descritores e usos internos do i-node
+	unsigned int numAllocatedBlocks; // posicoes mapeadas no inode, buracos inclusive
+	unsigned int delayedStart;		 // primeiro bloco com alocacao postergada
+	unsigned int numDelayedBlocks;	 // blocos a partir de delayedStart, ainda sem endereco fisico
+	unsigned int numReservedInodes;	 // i-nodes reservados para enderecar os blocos postergados
+	unsigned char *delayedData;		 // conteudo dos blocos com alocacao postergada
+	unsigned int tailBlock;			 // bloco final parcial mantido fixado no cache
+	unsigned int tailAddr;			 // endereco fisico de tailBlock
+	unsigned char *tailData;		 // dados de tailBlock no cache ou NULL se nenhum
+	struct openInode *tailPrev;		 // bloco final fixado mais recentemente usado
+	struct openInode *tailNext;		 // bloco final fixado menos recentemente usado
+	struct openInode *hashNext;
+} OpenInode;
+OpenInode *openInodes[OPEN_INODE_HASH_SIZE];
+OpenInode *openRoot = NULL; // referencia permanente a raiz
+
+// blocos finais fixados no cache ocupam no maximo 1/TAIL_PIN_FRACTION das
+// entradas do cache; alem disso, o fixado ha mais tempo sem uso e' liberado
+#define TAIL_PIN_FRACTION 8
+OpenInode *tailLruHead = NULL;
+OpenInode *tailLruTail = NULL;
+unsigned int numPinnedTails = 0;
+
+typedef struct fileDescriptor
+{
+	unsigned int fd;
+	OpenInode *file;
+	unsigned long long cursor;
+	int append;					  // escritas sempre no fim do arquivo
+	unsigned int nextReadBlock;	  // bloco seguinte a ultima leitura
+	unsigned int readaheadWindow; // blocos a antecipar alem da leitura atual
+	unsigned int readaheadEnd;	  // primeiro bloco ainda nao antecipado
+	char *dirName;				  // diretorio lido pela arvore de nomes: ultimo nome lido
 } FileDescriptor;
+// tabela de descritores indexada pelo proprio fd (posicao fd - 1); fds
+// liberados sao empilhados para reuso, mantendo os fds entre 1 e MAX_FDS
 FileDescriptor *openFiles[MAX_OPEN_FILES];
 unsigned int numOpenFiles = 0;
-unsigned int lastFd = 0;
+unsigned int numUsedFds = 0; // fds ja entregues alguma vez: 1 a numUsedFds
+unsigned int freeFds[MAX_OPEN_FILES];
+unsigned int numFreeFds = 0;
+
+// mapeamentos de arquivos em memoria: cada pagina tem o tamanho de um bloco
+// e e' trazida do arquivo apenas no primeiro acesso (myFSMfault)
+#define MAP_PAGE_ABSENT 0
+#define MAP_PAGE_LOADED 1
+#define MAP_PAGE_DIRTY 2
+typedef struct mapping
+{
+	FileDescriptor view;	   // acesso ao arquivo, com leitura antecipada propria
+	unsigned long long offset; // posicao no arquivo da primeira pagina
+	unsigned int numPages;
+	char *data;				   // paginas, contiguas, visiveis ao processo
+	unsigned char *pageState; // MAP_PAGE_* de cada pagina
+	struct mapping *next;
+} Mapping;
+Mapping *mappings = NULL;
+
+// cache de nomes: associa (diretorio, nome) ao i-node da entrada, ou a 0 se
+// o nome nao existe no diretorio (entrada negativa), para que a travessia
+// de caminhos nao leia os diretorios a cada abertura. E' atualizado a cada
+// insercao e remocao de entradas e descarta as menos usadas ao atingir
+// DENTRY_CACHE_SIZE entradas
+#define DENTRY_HASH_SIZE 256
+#define DENTRY_CACHE_SIZE 1024
+typedef struct dentry
+{
+	unsigned int parent;	  // i-node do diretorio
+	unsigned int inodeNumber; // i-node da entrada ou 0 se negativa
+	struct dentry *hashNext;
+	struct dentry *lruPrev; // mais recentemente usada
+	struct dentry *lruNext; // menos recentemente usada
+	char name[];
+} Dentry;
+Dentry *dentries[DENTRY_HASH_SIZE];
+Dentry *dentryLruHead = NULL;
+Dentry *dentryLruTail = NULL;
+unsigned int numDentries = 0;
 
 unsigned int inodeGetLastBlockAddr(Inode *inode)
 {
-	unsigned int totalSize = inodeGetFileSize(inode);
+	unsigned long long totalSize = inodeGetFileSize(inode);
 	unsigned int lastBlock = totalSize / superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
 	if (totalSize % superblock[SUPERBLOCK_ITEM_BLOCKSIZE] == 0)
 		lastBlock--;
 	return inodeGetBlockAddr(inode, lastBlock);
 }
 
+// Maior tamanho de arquivo suportado: o limite do formato do i-node, restrito
+// ainda a INT_MAX blocos para que indices de bloco caibam em unsigned int
+unsigned long long maxFileSize(void)
+{
+	unsigned long long maxSize = (unsigned long long)superblock[SUPERBLOCK_ITEM_BLOCKSIZE] * INT_MAX;
+	return inodeMaxFileSize() < maxSize ? inodeMaxFileSize() : maxSize;
+}
+
+// Leitura e escrita de blocos passam pelo cache de blocos (cache.c), que
+// so grava em disco na substituicao de um bloco ou em cacheSync
 int writeBlock(Disk *d, unsigned int block, const char *buf, unsigned int size)
 {
 	unsigned int sectorPerBlock = superblock[SUPERBLOCK_ITEM_BLOCKSIZE] / DISK_SECTORDATASIZE;
-	unsigned int firstSector = block * sectorPerBlock;
-	if (buf == NULL || firstSector < inodeAreaBeginSector())
+	unsigned long firstSector = (unsigned long)block * sectorPerBlock;
+	if (buf == NULL || firstSector < inodeAreaBeginSector() || d != cacheGetDisk())
 		return -1;
-	if (size > superblock[SUPERBLOCK_ITEM_BLOCKSIZE])
-		size = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
-	for (unsigned int i = 0; i < sectorPerBlock; i++)
-	{
-		unsigned int sizeToWrite = size > DISK_SECTORDATASIZE ? DISK_SECTORDATASIZE : size;
-		unsigned char sector[DISK_SECTORDATASIZE];
-		memcpy(sector, &buf[i * DISK_SECTORDATASIZE], sizeToWrite);
-		if (diskWriteSector(d, firstSector + i, sector) == -1)
-			return -1;
-		size -= sizeToWrite;
-	}
-	return 0;
+	return cacheWrite(block, (const unsigned char *)buf, size);
+}
+
+// Grava um bloco inteiro direto de buf para o disco, sem passar pela copia
+// em cache; usado quando o bloco e' totalmente sobrescrito
+int writeFullBlock(Disk *d, unsigned int block, const char *buf)
+{
+	unsigned int sectorPerBlock = superblock[SUPERBLOCK_ITEM_BLOCKSIZE] / DISK_SECTORDATASIZE;
+	unsigned long firstSector = (unsigned long)block * sectorPerBlock;
+	if (buf == NULL || firstSector < inodeAreaBeginSector() || d != cacheGetDisk())
+		return -1;
+	return cacheWriteDirect(block, (const unsigned char *)buf);
 }
 
 int readBlock(Disk *d, unsigned int block, char *buf)
 {
 	unsigned int sectorPerBlock = superblock[SUPERBLOCK_ITEM_BLOCKSIZE] / DISK_SECTORDATASIZE;
-	unsigned int firstSector = block * sectorPerBlock;
-	if (buf == NULL || firstSector < inodeAreaBeginSector())
+	unsigned long firstSector = (unsigned long)block * sectorPerBlock;
+	if (buf == NULL || firstSector < inodeAreaBeginSector() || d != cacheGetDisk())
 		return -1;
-	for (unsigned int i = 0; i < sectorPerBlock; i++)
-	{
-		unsigned char sector[DISK_SECTORDATASIZE];
-		if (diskReadSector(d, firstSector + i, sector) == -1)
-			return -1;
-		memcpy(&buf[i * DISK_SECTORDATASIZE], sector, DISK_SECTORDATASIZE);
-	}
-	return 0;
+	return cacheRead(block, (unsigned char *)buf);
 }
 
 // Funções do superbloco
 int saveSuperblock(Disk *d)
 {
 	unsigned char sector[DISK_SECTORDATASIZE];
+	memset(sector, 0, DISK_SECTORDATASIZE);
 	for (int a = 0; a < SUPERBLOCK_SIZE; a++)
 		ul2char(superblock[a], &sector[a * sizeof(unsigned int)]);
 	return diskWriteSector(d, SUPERBLOCK_SECTOR, sector);
@@ -131,6 +242,11 @@ int loadSuperblock(Disk *d)
 		return -1;
 	for (int a = 0; a < SUPERBLOCK_SIZE; a++)
 		char2ul(&sector[a * sizeof(unsigned int)], &(superblock[a]));
+	// discos antigos tem lixo apos os itens que conheciam
+	if (superblock[SUPERBLOCK_ITEM_LAYOUT] != SUPERBLOCK_LAYOUT_64BIT)
+		superblock[SUPERBLOCK_ITEM_LAYOUT] = 0;
+	inodeSetAreaNumInodes(superblock[SUPERBLOCK_ITEM_NUMINODES]);
+	inodeSetLayout(superblock[SUPERBLOCK_ITEM_LAYOUT] == SUPERBLOCK_LAYOUT_64BIT ? INODE_LAYOUT_64BIT_SIZE : INODE_LAYOUT_32BIT_SIZE);
 	return 0;
 }
 
@@ -139,21 +255,47 @@ int loadBitmap(Disk *d)
 {
 	if (bitmap != NULL)
 		return 0;
-	bitmap = calloc(superblock[SUPERBLOCK_ITEM_NUMBLOCKS], sizeof(unsigned char));
-	unsigned char *buffer = malloc(superblock[SUPERBLOCK_ITEM_BLOCKSIZE] * sizeof(unsigned char));
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned int numBlocks = superblock[SUPERBLOCK_ITEM_NUMBLOCKS];
+	bitmap = calloc(numBlocks, sizeof(unsigned char));
+	unsigned char *buffer = malloc(blockSize * sizeof(unsigned char));
 	if (bitmap == NULL || buffer == NULL)
+	{
+		free(bitmap);
+		free(buffer);
+		bitmap = NULL;
 		return -1;
-	int response = readBlock(d, superblock[SUPERBLOCK_ITEM_BITMAPBLOCK], buffer);
-	memcpy(bitmap, buffer, superblock[SUPERBLOCK_ITEM_NUMBLOCKS] * sizeof(unsigned char));
+	}
+	int response = 0;
+	for (unsigned int i = 0; i < divideCeil(numBlocks, blockSize) && response == 0; i++)
+	{
+		unsigned int size = numBlocks - i * blockSize < blockSize ? numBlocks - i * blockSize : blockSize;
+		response = readBlock(d, superblock[SUPERBLOCK_ITEM_BITMAPBLOCK] + i, (char *)buffer);
+		memcpy(&bitmap[i * blockSize], buffer, size);
+	}
 	free(buffer);
+	bitmapDirtyFrom = bitmapDirtyTo = 0;
 	return response;
 }
 
+// Grava o bitmap e o superbloco, cujos contadores de blocos e i-nodes
+// livres acompanham as alteracoes do bitmap
 int saveBitmap(Disk *d)
 {
 	if (bitmap == NULL)
 		return -1;
-	return writeBlock(d, superblock[SUPERBLOCK_ITEM_BITMAPBLOCK], bitmap, superblock[SUPERBLOCK_ITEM_NUMBLOCKS] * sizeof(unsigned char));
+	if (saveSuperblock(d) == -1)
+		return -1;
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned int numBlocks = superblock[SUPERBLOCK_ITEM_NUMBLOCKS];
+	for (unsigned int i = bitmapDirtyFrom / blockSize; i < divideCeil(bitmapDirtyTo, blockSize); i++)
+	{
+		unsigned int size = numBlocks - i * blockSize < blockSize ? numBlocks - i * blockSize : blockSize;
+		if (writeBlock(d, superblock[SUPERBLOCK_ITEM_BITMAPBLOCK] + i, (char *)&bitmap[i * blockSize], size) == -1)
+			return -1;
+	}
+	bitmapDirtyFrom = bitmapDirtyTo = 0;
+	return 0;
 }
 
 int findFreeBlocks(unsigned int numBlocks, unsigned int *blocks)
@@ -174,341 +316,2458 @@ int findFreeBlocks(unsigned int numBlocks, unsigned int *blocks)
 	return -1;
 }
 
-int setBlocksStatus(unsigned int numBlocks, unsigned int *blocks, char status)
+// Procura numBlocks blocos livres consecutivos no intervalo [from, to).
+// Em caso de sucesso, preenche blocks com os enderecos e retorna 0
+int findFreeRun(unsigned int from, unsigned int to, unsigned int numBlocks, unsigned int *blocks)
 {
-	if (status != 0 && status != 1)
-		return -1;
-	for (unsigned int i = 0; i < numBlocks; i++)
-		bitmap[blocks[i]] = status;
-	return 0;
+	unsigned int runLength = 0;
+	for (unsigned int i = from; i < to; i++)
+	{
+		runLength = bitmap[i] == 0 ? runLength + 1 : 0;
+		if (runLength == numBlocks)
+		{
+			for (unsigned int j = 0; j < numBlocks; j++)
+				blocks[j] = i + 1 - numBlocks + j;
+			return 0;
+		}
+	}
+	return -1;
 }
 
-// funções do diretório
-typedef struct directoryEntry
-{
-	char name[MAX_FILENAME_LENGTH];
-	unsigned int inodeNumber;
-} DirectoryEntry;
-
-typedef struct directory
+// Procura numBlocks blocos livres consecutivos, primeiro a partir de goal
+// (normalmente o bloco seguinte ao fim do arquivo) e depois do inicio do
+// disco. Em caso de sucesso, preenche blocks com a extensao e retorna 0
+int findFreeExtent(unsigned int goal, unsigned int numBlocks, unsigned int *blocks)
 {
-	DirectoryEntry **entries;
-	unsigned int numEntries;
-} Directory;
+	if (numBlocks <= 0)
+		return 0;
+	if (goal >= superblock[SUPERBLOCK_ITEM_NUMBLOCKS])
+		goal = 0;
+	if (findFreeRun(goal, superblock[SUPERBLOCK_ITEM_NUMBLOCKS], numBlocks, blocks) == 0)
+		return 0;
+	return findFreeRun(0, superblock[SUPERBLOCK_ITEM_NUMBLOCKS], numBlocks, blocks);
+}
 
-void freeDirectory(Directory *dir)
+// Inclui as entradas [from, to) do bitmap no trecho a regravar
+void markBitmapDirty(unsigned int from, unsigned int to)
 {
-	if (dir == NULL)
+	if (bitmapDirtyFrom == bitmapDirtyTo)
+	{
+		bitmapDirtyFrom = from;
+		bitmapDirtyTo = to;
 		return;
-	if (dir->entries != NULL)
-		for (unsigned int i = 0; i < dir->numEntries; i++)
-			free(dir->entries[i]);
-	free(dir->entries);
-	free(dir);
+	}
+	if (from < bitmapDirtyFrom)
+		bitmapDirtyFrom = from;
+	if (to > bitmapDirtyTo)
+		bitmapDirtyTo = to;
 }
 
-Directory *loadDirectory(Disk *d, Inode *inode)
+int setBlocksStatus(unsigned int numBlocks, unsigned int *blocks, char status)
 {
-	if (inodeGetFileType(inode) != FILETYPE_DIR)
-		return NULL;
-	Directory *responseDir;
-	Directory *dir = malloc(sizeof(Directory));
-	if (dir == NULL)
-		return NULL;
-	unsigned int numBlocks = divideCeil(inodeGetFileSize(inode), superblock[SUPERBLOCK_ITEM_BLOCKSIZE]);
-	unsigned char *buffer = malloc(numBlocks * superblock[SUPERBLOCK_ITEM_BLOCKSIZE]);
-	unsigned int bufferOffset = 0;
+	if (status != 0 && status != 1)
+		return -1;
 	for (unsigned int i = 0; i < numBlocks; i++)
 	{
-		if (readBlock(d, inodeGetBlockAddr(inode, i), &buffer[bufferOffset]) == -1)
-			break;
-		bufferOffset += superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
-	}
-	if (bufferOffset == numBlocks * superblock[SUPERBLOCK_ITEM_BLOCKSIZE])
-	{
-		bufferOffset = 0;
-		char2ul(buffer, &(dir->numEntries));
-		bufferOffset += sizeof(unsigned int);
-		if (dir->numEntries > 0)
-			dir->entries = malloc(dir->numEntries * sizeof(DirectoryEntry *));
+		if (bitmap[blocks[i]] == status)
+			continue;
+		bitmap[blocks[i]] = status;
+		markBitmapDirty(blocks[i], blocks[i] + 1);
+		if (status == 1)
+			superblock[SUPERBLOCK_ITEM_FREEBLOCKS]--;
 		else
-		{
-			dir->entries = NULL;
-			responseDir = dir; // response dir != NULL > SUCCESS
-		}
-		if (dir->entries != NULL)
-		{
-			for (unsigned int i = 0; i < dir->numEntries; i++)
-			{
-				dir->entries[i] = malloc(sizeof(DirectoryEntry));
-				if (dir->entries[i] == NULL)
-					break;
-				char2ul(&buffer[bufferOffset], &(dir->entries[i]->inodeNumber));
-				bufferOffset += sizeof(unsigned int);
-				memcpy(dir->entries[i]->name, &buffer[bufferOffset], MAX_FILENAME_LENGTH * sizeof(char));
-				bufferOffset += MAX_FILENAME_LENGTH * sizeof(char);
-			}
-
-			if (bufferOffset == inodeGetFileSize(inode))
-				responseDir = dir;
-		}
+			superblock[SUPERBLOCK_ITEM_FREEBLOCKS]++;
 	}
-
-	free(buffer);
-	if (responseDir == NULL)
-		freeDirectory(dir);
-	return responseDir;
+	return 0;
 }
 
-int setDirNumEntries(Disk *d, unsigned int firstBlock, unsigned int numEntries)
+// Marca blocos como livres, descartando suas copias em cache
+void releaseBlocks(unsigned int numBlocks, unsigned int *blocks)
 {
-	unsigned int firstSector = firstBlock * superblock[SUPERBLOCK_ITEM_BLOCKSIZE] / DISK_SECTORDATASIZE;
-	unsigned char sector[DISK_SECTORDATASIZE];
-	if (diskReadSector(d, firstSector, sector) == -1)
-		return -1;
-	ul2char(numEntries, sector);
-	if (diskWriteSector(d, firstSector, sector) == -1)
-		return -1;
+	for (unsigned int i = 0; i < numBlocks; i++)
+		cacheInvalidate(blocks[i]);
+	setBlocksStatus(numBlocks, blocks, 0);
 }
 
-int addDirectoryEntry(Disk *d, Inode *inodeDir, Inode *inodeEntry, const char *entryName)
+// Enfileira numBlocks blocos e, se chain for diferente de 0, a cadeia de
+// extensoes iniciada em chain para liberacao em reclaimSpace. Retorna 0 se
+// bem sucedido ou -1 caso contrario
+int queueReclaim(unsigned int numBlocks, unsigned int *blocks, unsigned int chain)
 {
-	Directory *dir = loadDirectory(d, inodeDir);
-	if (dir == NULL)
-		return -1;
-	for (unsigned int i = 0; i < dir->numEntries; i++)
+	if (numBlocks > 0)
 	{
-		if (strcmp(dir->entries[i]->name, entryName) == 0)
-		{
-			freeDirectory(dir);
+		unsigned int *queued = realloc(reclaimQueue.blocks, (reclaimQueue.numBlocks + numBlocks) * sizeof(unsigned int));
+		if (queued == NULL)
 			return -1;
-		}
+		memcpy(&queued[reclaimQueue.numBlocks], blocks, numBlocks * sizeof(unsigned int));
+		reclaimQueue.blocks = queued;
+		reclaimQueue.numBlocks += numBlocks;
 	}
-
-	DirectoryEntry *entry = malloc(sizeof(DirectoryEntry));
-	if (entry == NULL)
+	if (chain != 0)
 	{
-		freeDirectory(dir);
-		return -1;
+		unsigned int *chains = realloc(reclaimQueue.chains, (reclaimQueue.numChains + 1) * sizeof(unsigned int));
+		if (chains == NULL)
+			return -1;
+		chains[reclaimQueue.numChains++] = chain;
+		reclaimQueue.chains = chains;
 	}
-	entry->inodeNumber = inodeGetNumber(inodeEntry);
-	strncpy(entry->name, entryName, MAX_FILENAME_LENGTH);
-
-	const size_t entrySize = sizeof(unsigned int) + MAX_FILENAME_LENGTH * sizeof(char);
-	unsigned char toSaveBuffer[entrySize];
-	ul2char(entry->inodeNumber, toSaveBuffer);
-	memcpy(&toSaveBuffer[sizeof(unsigned int)], entry->name, MAX_FILENAME_LENGTH * sizeof(char));
-	free(entry);
-
-	unsigned int finalBlock = inodeGetLastBlockAddr(inodeDir);
-	unsigned int finalBlockOffset = inodeGetFileSize(inodeDir) % superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
-	unsigned int finalBlockFreeSpace = superblock[SUPERBLOCK_ITEM_BLOCKSIZE] - finalBlockOffset;
-	unsigned char *finalBlockBuffer = malloc(superblock[SUPERBLOCK_ITEM_BLOCKSIZE]);
+	return 0;
+}
 
-	if (readBlock(d, finalBlock, finalBlockBuffer) == -1)
-	{
-		freeDirectory(dir);
-		free(finalBlockBuffer);
-		return -1;
-	}
+// Libera os blocos enfileirados e ate maxExtensions extensoes das cadeias
+// enfileiradas, com seus blocos. Bitmap e superbloco sao gravados uma unica
+// vez ao final. Retorna 0 se bem sucedido ou -1 caso contrario
+int reclaimSpace(Disk *d, unsigned int maxExtensions)
+{
+	if (reclaimQueue.numBlocks == 0 && reclaimQueue.numChains == 0)
+		return 0;
+	releaseBlocks(reclaimQueue.numBlocks, reclaimQueue.blocks);
+	free(reclaimQueue.blocks);
+	reclaimQueue.blocks = NULL;
+	reclaimQueue.numBlocks = 0;
 
-	unsigned int newBlock = 0;
-	unsigned char *newBlockBuffer = NULL;
-	if (finalBlockFreeSpace >= entrySize)
-		memcpy(&finalBlockBuffer[finalBlockOffset], toSaveBuffer, entrySize);
-	else
+	int ret = 0;
+	unsigned int *addrs = malloc(inodeNumItemsPerExtension() * sizeof(unsigned int));
+	if (addrs == NULL)
+		ret = -1;
+	for (unsigned int n = 0; addrs != NULL && n < maxExtensions && reclaimQueue.numChains > 0; n++)
 	{
-		unsigned int blocks[1];
-		if (findFreeBlocks(1, blocks) == -1)
-		{
-			freeDirectory(dir);
-			free(finalBlockBuffer);
-			return -1;
-		}
-		newBlock = blocks[0];
-		newBlockBuffer = malloc(superblock[SUPERBLOCK_ITEM_BLOCKSIZE]);
-		for (unsigned int i = 0; i < entrySize; i++)
+		unsigned int *chain = &reclaimQueue.chains[reclaimQueue.numChains - 1];
+		unsigned int next = 0;
+		int numAddrs = inodeReleaseExtension(*chain, d, addrs, &next);
+		if (numAddrs == -1)
 		{
-			if (finalBlockOffset >= superblock[SUPERBLOCK_ITEM_BLOCKSIZE])
-				newBlockBuffer[finalBlockOffset - superblock[SUPERBLOCK_ITEM_BLOCKSIZE]] = toSaveBuffer[i];
-			else
-				finalBlockBuffer[finalBlockOffset] = toSaveBuffer[i];
-			finalBlockOffset++;
+			ret = -1;
+			break;
 		}
+		releaseBlocks(numAddrs, addrs);
+		superblock[SUPERBLOCK_ITEM_FREEINODES]++;
+		if (next != 0)
+			*chain = next;
+		else
+			reclaimQueue.numChains--;
 	}
-
-	if (writeBlock(d, finalBlock, finalBlockBuffer, superblock[SUPERBLOCK_ITEM_BLOCKSIZE]) == -1)
-	{
-		freeDirectory(dir);
-		free(finalBlockBuffer);
-		free(newBlockBuffer);
-		return -1;
-	}
-	if (newBlockBuffer != NULL && writeBlock(d, newBlock, newBlockBuffer, superblock[SUPERBLOCK_ITEM_BLOCKSIZE]) == -1)
-	{
-		freeDirectory(dir);
-		free(finalBlockBuffer);
-		free(newBlockBuffer);
+	free(addrs);
+	if (saveBitmap(d) == -1)
 		return -1;
-	}
-
-	if (newBlock != 0)
-		inodeAddBlock(inodeDir, newBlock);
-	inodeSetFileSize(inodeDir, inodeGetFileSize(inodeDir) + entrySize);
-	inodeSetRefCount(inodeEntry, inodeGetRefCount(inodeEntry) + 1);
+	return ret;
+}
 
-	free(newBlockBuffer);
-	free(finalBlockBuffer);
-	unsigned int newNumEntries = dir->numEntries + 1;
-	freeDirectory(dir);
+// Verifica se ha numBlocks blocos livres alem dos reservados, recuperando
+// antes o espaco pendente se faltar. Retorna 0 se houver ou -1 caso contrario
+int ensureFreeBlocks(Disk *d, unsigned int numBlocks)
+{
+	if (superblock[SUPERBLOCK_ITEM_FREEBLOCKS] < reservedBlocks + numBlocks)
+		reclaimSpace(d, RECLAIM_ALL);
+	if (superblock[SUPERBLOCK_ITEM_FREEBLOCKS] < reservedBlocks + numBlocks)
+		return -1;
+	return 0;
+}
 
-	if (inodeSave(inodeEntry) == -1 || inodeSave(inodeDir) == -1 || saveBitmap(d) == -1)
+// Reserva numBlocks blocos para alocacao postergada, sem escolher quais.
+// Retorna -1 se o disco nao comportar a reserva
+int reserveBlocks(Disk *d, unsigned int numBlocks)
+{
+	if (ensureFreeBlocks(d, numBlocks) == -1)
 		return -1;
-	return setDirNumEntries(d, inodeGetBlockAddr(inodeDir, 0), newNumEntries);
+	reservedBlocks += numBlocks;
+	return 0;
 }
 
-int createDirectory(Disk *d, Inode *inode)
+// Escolhe numBlocks blocos livres fora dos reservados, de preferencia uma
+// extensao contigua a partir de goal. E' o ponto de entrada para alocacoes
+// imediatas; os blocos so passam a ocupados com setBlocksStatus. Retorna 0
+// se bem sucedido ou -1 se nao houver espaco
+int allocateBlocks(Disk *d, unsigned int goal, unsigned int numBlocks, unsigned int *blocks)
 {
-	unsigned int numEntries = 0;
-	unsigned int blocks[1];
-	if (findFreeBlocks(1, blocks) == 0)
-	{
-		unsigned char buf[sizeof(unsigned int)];
-		ul2char(numEntries, buf);
-		if (writeBlock(d, blocks[0], buf, sizeof(unsigned int)) == 0)
-		{
-			inodeSetFileSize(inode, sizeof(unsigned int));
-			inodeSetFileType(inode, FILETYPE_DIR);
-			inodeSetGroupOwner(inode, 0);
-			inodeSetOwner(inode, 0);
-			inodeSetPermission(inode, 0);
-			inodeAddBlock(inode, blocks[0]);
-			setBlocksStatus(1, blocks, 1);
-			saveBitmap(d);
-			return addDirectoryEntry(d, inode, inode, ".");
-		}
-	}
-	return -1;
+	if (ensureFreeBlocks(d, numBlocks) == -1)
+		return -1;
+	if (findFreeExtent(goal, numBlocks, blocks) == -1 && findFreeBlocks(numBlocks, blocks) == -1)
+		return -1;
+	return 0;
 }
 
-unsigned int findInodeNumber(Directory *dir, const char *name)
+// Recalcula os contadores de blocos e i-nodes livres percorrendo o bitmap e
+// a area de i-nodes. So e' necessario para discos formatados antes de o
+// superbloco manter esses contadores
+int recountFreeSpace(Disk *d)
 {
-	for (unsigned int i = 0; i < dir->numEntries; i++)
+	superblock[SUPERBLOCK_ITEM_FREEBLOCKS] = 0;
+	for (unsigned int i = 0; i < superblock[SUPERBLOCK_ITEM_NUMBLOCKS]; i++)
+		if (bitmap[i] == 0)
+			superblock[SUPERBLOCK_ITEM_FREEBLOCKS]++;
+	superblock[SUPERBLOCK_ITEM_FREEINODES] = 0;
+	for (unsigned int i = 1; i <= superblock[SUPERBLOCK_ITEM_NUMINODES]; i++)
 	{
-		if (strcmp(dir->entries[i]->name, name) == 0)
-			return dir->entries[i]->inodeNumber;
+		Inode *inode = inodeLoad(i, d);
+		if (inode == NULL)
+			return -1;
+		if (inodeIsFree(inode))
+			superblock[SUPERBLOCK_ITEM_FREEINODES]++;
+		free(inode);
 	}
-
-	return 0;
+	return saveSuperblock(d);
 }
 
-// funções open file
-FileDescriptor *createFileDescriptor(Disk *d, Inode *inode)
+// Da o tipo fileType ao i-node livre escolhido por findFreeInode para um novo
+// arquivo, contabilizando-o como ocupado no superbloco, e o grava, para que
+// deixe de parecer livre a buscas por extensoes. O i-node passa a ser
+// devolvido ao contador por releaseInode, mesmo que nunca receba blocos.
+// Retorna 0 se bem sucedido ou -1 caso contrario
+int claimInode(Disk *d, Inode *inode, unsigned int fileType)
 {
-	if (numOpenFiles >= MAX_OPEN_FILES)
-		return NULL;
-	FileDescriptor *openFile = malloc(sizeof(FileDescriptor));
-	if (openFile == NULL)
-		return NULL;
-	openFile->fd = ++lastFd;
-	openFile->inode = inode;
-	openFile->disk = d;
-	openFile->cursor = 0;
-	openFiles[numOpenFiles++] = openFile;
-	return openFile;
+	inodeSetFileType(inode, fileType);
+	superblock[SUPERBLOCK_ITEM_FREEINODES]--;
+	if (inodeSave(inode) == -1)
+		return -1;
+	return saveSuperblock(d);
 }
 
-FileDescriptor *getFileDescriptor(unsigned int fd)
+// Numero de extensoes, alem do primeiro i-node da cadeia, necessarias para
+// enderecar numBlocks blocos
+unsigned int numExtensionsForBlocks(unsigned int numBlocks)
 {
-	if (numOpenFiles == 0)
-		return NULL;
-	for (unsigned int i = 0; i < numOpenFiles; i++)
-	{
-		if (openFiles[i]->fd == fd)
-			return openFiles[i];
-	}
-
-	return NULL;
+	unsigned int numInodes = inodeNumInodesForBlocks(numBlocks);
+	return numInodes > 0 ? numInodes - 1 : 0;
 }
 
-int loadFSData(Disk *d)
+// Define blockAddr como bloco de indice blockNum do inode, que possui
+// numMappedBlocks posicoes mapeadas (buracos inclusive), contabilizando no
+// superbloco as extensoes criadas
+int setInodeBlock(Inode *inode, unsigned int numMappedBlocks, unsigned int blockNum, unsigned int blockAddr)
 {
-	if (d == NULL)
+	unsigned int numNewInodes = 0;
+	if (blockNum >= numMappedBlocks)
+		numNewInodes = numExtensionsForBlocks(blockNum + 1) - numExtensionsForBlocks(numMappedBlocks);
+	if (superblock[SUPERBLOCK_ITEM_FREEINODES] < reservedInodes + numNewInodes)
 		return -1;
-	if (loadSuperblock(d) == -1)
+	if (inodeSetBlockAddr(inode, blockNum, blockAddr) == -1)
 		return -1;
-	if (loadBitmap(d) == -1)
+	superblock[SUPERBLOCK_ITEM_FREEINODES] -= numNewInodes;
+	return 0;
+}
+
+// Como setInodeBlock, para os numBlocks blocos a partir de firstBlock, com
+// uma unica passagem pela cadeia de extensoes. O primeiro i-node da cadeia
+// nao e' gravado
+int setInodeBlocks(Inode *inode, unsigned int numMappedBlocks, unsigned int firstBlock, unsigned int numBlocks, unsigned int *blockAddrs)
+{
+	unsigned int numNewInodes = 0;
+	if (firstBlock + numBlocks > numMappedBlocks)
+		numNewInodes = numExtensionsForBlocks(firstBlock + numBlocks) - numExtensionsForBlocks(numMappedBlocks);
+	if (superblock[SUPERBLOCK_ITEM_FREEINODES] < reservedInodes + numNewInodes)
 		return -1;
-	if (loadRootInode(d) == -1)
+	if (inodeSetBlockAddrs(inode, firstBlock, numBlocks, blockAddrs) == -1)
 		return -1;
+	superblock[SUPERBLOCK_ITEM_FREEINODES] -= numNewInodes;
 	return 0;
 }
 
-// Funcao para verificacao se o sistema de arquivos está ocioso, ou seja,
-// se nao ha quisquer descritores de arquivos em uso atualmente. Retorna
-// um positivo se ocioso ou, caso contrario, 0.
-int myFSIsIdle(Disk *d)
+// Encontra um i-node livre para um novo arquivo. Retorna 0 se nao houver
+unsigned int findFreeInode(Disk *d)
 {
-	if (numOpenFiles > 0)
+	if (superblock[SUPERBLOCK_ITEM_FREEINODES] <= reservedInodes)
+		reclaimSpace(d, RECLAIM_ALL);
+	if (superblock[SUPERBLOCK_ITEM_FREEINODES] <= reservedInodes)
 		return 0;
-	return 1;
+	unsigned int inodeNumber = inodeFindFreeInode(ROOT_INODE_NUMBER + 1, d);
+	if (inodeNumber > superblock[SUPERBLOCK_ITEM_NUMINODES])
+		return 0;
+	return inodeNumber;
 }
 
-// Funcao para formatacao de um disco com o novo sistema de arquivos
-// com tamanho de blocos igual a blockSize. Retorna o numero total de
-// blocos disponiveis no disco, se formatado com sucesso. Caso contrario,
-// retorna -1.
-int myFSFormat(Disk *d, unsigned int blockSize)
+unsigned int dentryHash(unsigned int parent, const char *name)
 {
-	// Verificação de parâmetros inválidos
-	if (d == NULL || blockSize == 0)
-		return -1;
-
-	// criar superbloco
-	superblock = malloc(SUPERBLOCK_SIZE * sizeof(unsigned int));
-	superblock[SUPERBLOCK_ITEM_BLOCKSIZE] = blockSize;
-	superblock[SUPERBLOCK_ITEM_NUMBLOCKS] = diskGetSize(d) / blockSize;
-	superblock[SUPERBLOCK_ITEM_NUMINODES] = superblock[SUPERBLOCK_ITEM_NUMBLOCKS] / NUMBLOCKS_PERINODE;
-
-	// Inicializar i-nodes
-	for (int i = 1; i < superblock[SUPERBLOCK_ITEM_NUMINODES] + 1; i++)
-	{
-		Inode *inode = inodeCreate(i, d);
-		if (inode == NULL)
-			return -1;
+	unsigned int hash = 2166136261u ^ parent;
+	for (; *name != '\0'; name++)
+		hash = (hash ^ (unsigned char)*name) * 16777619u;
+	return hash % DENTRY_HASH_SIZE;
+}
 
-		if (i == ROOT_INODE_NUMBER)
-			inodeRoot = inode;
-		else
-			free(inode);
-	}
+void unlinkDentryLru(Dentry *dentry)
+{
+	if (dentry->lruPrev != NULL)
+		dentry->lruPrev->lruNext = dentry->lruNext;
+	else
+		dentryLruHead = dentry->lruNext;
+	if (dentry->lruNext != NULL)
+		dentry->lruNext->lruPrev = dentry->lruPrev;
+	else
+		dentryLruTail = dentry->lruPrev;
+}
 
-	// criar bitmap
-	bitmap = calloc(superblock[SUPERBLOCK_ITEM_NUMBLOCKS], sizeof(unsigned char));
-	unsigned int inodesSectors = superblock[SUPERBLOCK_ITEM_NUMINODES] / inodeNumInodesPerSector();
-	unsigned int inodesBlocks = divideCeil((inodesSectors + inodeAreaBeginSector()) * DISK_SECTORDATASIZE, blockSize);
-	for (int i = 0; i < inodesBlocks + 1; i++)
-		bitmap[i] = 1;
-	superblock[SUPERBLOCK_ITEM_BITMAPBLOCK] = inodesBlocks;
-	if (saveSuperblock(d) == -1)
-		return -1;
-	if (saveBitmap(d) == -1)
-		return -1;
+void pushDentryLru(Dentry *dentry)
+{
+	dentry->lruPrev = NULL;
+	dentry->lruNext = dentryLruHead;
+	if (dentryLruHead != NULL)
+		dentryLruHead->lruPrev = dentry;
+	else
+		dentryLruTail = dentry;
+	dentryLruHead = dentry;
+}
 
-	// create root
-	if (createDirectory(d, inodeRoot) == -1)
-		return -1;
-	if (addDirectoryEntry(d, inodeRoot, inodeRoot, "..") == -1)
-		return -1;
-	return superblock[SUPERBLOCK_ITEM_NUMBLOCKS];
+void freeDentry(Dentry *dentry)
+{
+	Dentry **link = &dentries[dentryHash(dentry->parent, dentry->name)];
+	while (*link != dentry)
+		link = &(*link)->hashNext;
+	*link = dentry->hashNext;
+	unlinkDentryLru(dentry);
+	numDentries--;
+	free(dentry);
 }
 
-int splitPath(const char *path, char ***entries)
+// Procura (parent, name) no cache de nomes. Retorna a entrada, marcada como
+// a mais recentemente usada, ou NULL se nao estiver no cache
+Dentry *findDentry(unsigned int parent, const char *name)
 {
-	if (path == NULL || path[0] == '\0')
+	Dentry *dentry = dentries[dentryHash(parent, name)];
+	while (dentry != NULL && (dentry->parent != parent || strcmp(dentry->name, name) != 0))
+		dentry = dentry->hashNext;
+	if (dentry != NULL && dentry != dentryLruHead)
 	{
-		*entries = NULL;
-		return 0;
+		unlinkDentryLru(dentry);
+		pushDentryLru(dentry);
+	}
+	return dentry;
+}
+
+// Guarda no cache de nomes que name, no diretorio parent, corresponde ao
+// i-node inodeNumber, ou que nao existe se inodeNumber for 0. Sem memoria,
+// a entrada simplesmente nao e' guardada
+void storeDentry(unsigned int parent, const char *name, unsigned int inodeNumber)
+{
+	Dentry *dentry = findDentry(parent, name);
+	if (dentry != NULL)
+	{
+		dentry->inodeNumber = inodeNumber;
+		return;
+	}
+	if (numDentries >= DENTRY_CACHE_SIZE)
+		freeDentry(dentryLruTail);
+	dentry = malloc(sizeof(Dentry) + strlen(name) + 1);
+	if (dentry == NULL)
+		return;
+	dentry->parent = parent;
+	dentry->inodeNumber = inodeNumber;
+	strcpy(dentry->name, name);
+	Dentry **bucket = &dentries[dentryHash(parent, name)];
+	dentry->hashNext = *bucket;
+	*bucket = dentry;
+	pushDentryLru(dentry);
+	numDentries++;
+}
+
+// Retira name, no diretorio parent, do cache de nomes
+void forgetDentry(unsigned int parent, const char *name)
+{
+	Dentry *dentry = findDentry(parent, name);
+	if (dentry != NULL)
+		freeDentry(dentry);
+}
+
+// Retira do cache de nomes todas as entradas do diretorio parent, ou todas
+// as entradas se parent for 0
+void forgetDentries(unsigned int parent)
+{
+	Dentry *dentry = dentryLruHead;
+	while (dentry != NULL)
+	{
+		Dentry *next = dentry->lruNext;
+		if (parent == 0 || dentry->parent == parent)
+			freeDentry(dentry);
+		dentry = next;
+	}
+}
+
+int releaseDirIndex(Disk *d, Inode *inodeDir);
+void forgetDirTreeMap(unsigned int inodeNumber);
+
+// Libera um i-node sem referencias: seus blocos e extensoes sao desligados
+// e enfileirados para recuperacao, sem percorrer a cadeia, e o i-node em si
+// e' zerado, ficando livre para reuso imediato. Retorna 0 se bem sucedido ou
+// -1 caso contrario
+int releaseInode(Disk *d, Inode *inode)
+{
+	if (inodeIsFree(inode))
+		return 0;
+	// o numero do i-node pode ser reusado por outra arvore de nomes
+	forgetDirTreeMap(inodeGetNumber(inode));
+	if (inodeGetFileType(inode) == FILETYPE_DIR)
+	{
+		// o numero do i-node pode ser reusado por outro diretorio
+		forgetDentries(inodeGetNumber(inode));
+		if (releaseDirIndex(d, inode) == -1)
+			return -1;
+	}
+	unsigned int *addrs = malloc(inodeNumItemsPerExtension() * sizeof(unsigned int));
+	if (addrs == NULL)
+		return -1;
+	unsigned int chain = 0;
+	int numAddrs = inodeTruncateBlocks(inode, 0, addrs, &chain);
+	if (numAddrs == -1 || queueReclaim(numAddrs, addrs, chain) == -1)
+	{
+		free(addrs);
+		return -1;
+	}
+	free(addrs);
+	if (inodeClear(inode) == -1)
+		return -1;
+	superblock[SUPERBLOCK_ITEM_FREEINODES]++;
+	return saveSuperblock(d);
+}
+
+// funções do diretório
+typedef struct directoryEntry
+{
+	const char *name; // na area de nomes do Directory, terminado em '\0'
+	unsigned int nameLength;
+	unsigned int inodeNumber;
+	unsigned int offset; // posicao do registro da entrada no diretorio
+} DirectoryEntry;
+
+// diretorio carregado em memoria com uma unica alocacao: o vetor de
+// entradas, contiguo, seguido da area com os nomes
+typedef struct directory
+{
+	unsigned int numEntries;
+	DirectoryEntry entries[];
+} Directory;
+
+// formato em disco: cabecalho seguido de registros de tamanho variavel
+// (numero do i-node, tamanho do registro, tamanho do nome e o nome), com
+// alinhamento de 4 bytes, agrupados em trechos de um setor que nenhum
+// registro atravessa. O ultimo registro de cada trecho vai ate o fim dele, e
+// a sobra de um registro alem do seu nome e' espaco livre para outro; um
+// registro com i-node 0 esta livre por inteiro. O cabecalho guarda o numero
+// de entradas e o i-node do indice dos nomes, uma arvore B+ criada quando o
+// diretorio atinge DIR_INDEX_THRESHOLD entradas
+#define DIR_COMPACT_MAGIC 0x4D594443
+#define DIR_HEADER_SIZE (4 * sizeof(unsigned int)) // assinatura, entradas, indice, slots usados do indice de hash
+#define DIR_CHUNK_SIZE DISK_SECTORDATASIZE
+#define DIR_RECORD_HEADER_SIZE 7 // i-node (4 bytes), tamanho do registro (2) e do nome (1)
+#define DIR_INDEX_THRESHOLD 64
+
+// formatos anteriores, apenas lidos: entradas de tamanho fixo apos um
+// cabecalho que e' so o numero de entradas ou, com indice, um cabecalho
+// identificado por DIR_INDEXED_MAGIC. O diretorio e' convertido para o
+// formato compacto na primeira alteracao
+#define DIR_FIXED_HEADER_SIZE sizeof(unsigned int)
+#define DIR_FIXED_ENTRY_SIZE (sizeof(unsigned int) + MAX_FILENAME_LENGTH * sizeof(char))
+#define DIR_INDEXED_MAGIC 0x4D594449
+
+#define DIR_FORMAT_FIXED 1
+#define DIR_FORMAT_COMPACT 2
+
+// indice de hash de versoes anteriores, apenas lido: tabela com
+// enderecamento aberto e sondagem linear, com numero de slots potencia de 2.
+// Cada slot guarda o hash do nome e a posicao da entrada no diretorio; as
+// posicoes 0 e 1, dentro do cabecalho, marcam slots vazios e removidos. O
+// indice e' trocado pela arvore de nomes na primeira alteracao do diretorio
+#define DIR_INDEX_SLOT_SIZE (2 * sizeof(unsigned int))
+#define DIR_INDEX_EMPTY 0
+#define DIR_INDEX_DELETED 1
+#define FILETYPE_DIRINDEX 32 // tipo do i-node de indice, interno ao MyFS
+
+// arvore de nomes: arvore B+ ordenada pelos bytes dos nomes, em nos de
+// DIR_TREE_NODE_SIZE bytes. O no 0 guarda o cabecalho (assinatura, raiz,
+// numero de nos e altura). Cada no comeca com o proximo no, o numero de
+// chaves, os bytes usados e se e' folha, seguidos das chaves em ordem, cada
+// uma com dois valores, o tamanho do nome e o nome. Nas folhas, os valores
+// sao o i-node e a posicao do registro da entrada, e o proximo no e' a folha
+// seguinte; nos nos internos, o primeiro valor e' o filho com os nomes a
+// partir da chave, e o proximo no e' o filho com os nomes menores que a
+// primeira chave. Nos esvaziados por remocoes nao sao fundidos
+#define DIR_TREE_MAGIC 0x4D594254
+#define DIR_TREE_NODE_SIZE 2048
+#define DIR_TREE_HEADER_SIZE (4 * sizeof(unsigned int))
+#define DIR_TREE_NODE_HEADER_SIZE (4 * sizeof(unsigned int))
+#define DIR_TREE_KEY_HEADER_SIZE (2 * sizeof(unsigned int) + 1)
+#define DIR_TREE_MAX_HEIGHT 16
+#define DIR_TREE_NODE_NEXT 0
+#define DIR_TREE_NODE_NUMKEYS 1
+#define DIR_TREE_NODE_USED 2
+#define DIR_TREE_NODE_LEAF 3
+#define FILETYPE_DIRTREE 33 // tipo do i-node da arvore de nomes, interno ao MyFS
+
+typedef struct dirHeader
+{
+	unsigned int format;	 // DIR_FORMAT_FIXED ou DIR_FORMAT_COMPACT
+	unsigned int size;		 // DIR_HEADER_SIZE ou DIR_FIXED_HEADER_SIZE
+	unsigned int numEntries;
+	unsigned int indexInode; // i-node do indice ou 0 se nao houver
+	unsigned int indexUsed;	 // slots ocupados do indice de hash; 0 com a arvore de nomes
+} DirHeader;
+
+// mapas de blocos das arvores de nomes usadas mais recentemente, para que
+// os nos sejam localizados sem percorrer a cadeia de extensoes
+#define DIR_TREE_MAP_CACHE_SIZE 8
+typedef struct dirTreeMap
+{
+	unsigned int inodeNumber; // i-node da arvore ou 0 se livre
+	unsigned int numBlocks;
+	unsigned int *blockAddrs;
+	unsigned int lastUse;
+} DirTreeMap;
+DirTreeMap dirTreeMaps[DIR_TREE_MAP_CACHE_SIZE];
+unsigned int dirTreeMapClock = 0;
+
+typedef struct dirTreeHeader
+{
+	unsigned int root;
+	unsigned int numNodes; // cabecalho inclusive
+	unsigned int height;   // niveis, folhas inclusive
+} DirTreeHeader;
+
+// resultado da busca de um nome em um diretorio
+typedef struct dirLookup
+{
+	unsigned int offset;	  // posicao da entrada encontrada
+	unsigned int inodeNumber; // i-node da entrada encontrada
+} DirLookup;
+
+unsigned int dirRecordSize(unsigned int nameLength)
+{
+	return (DIR_RECORD_HEADER_SIZE + nameLength + 3) & ~3u;
+}
+
+// Posicao do primeiro registro de um trecho: no primeiro trecho, apos o
+// cabecalho
+unsigned int dirChunkStart(unsigned int chunkOffset)
+{
+	return chunkOffset == 0 ? DIR_HEADER_SIZE : 0;
+}
+
+void freeDirectory(Directory *dir)
+{
+	free(dir);
+}
+
+void decodeDirHeader(const unsigned char *buf, DirHeader *header)
+{
+	unsigned int firstItem;
+	char2ul((unsigned char *)buf, &firstItem);
+	if (firstItem != DIR_COMPACT_MAGIC && firstItem != DIR_INDEXED_MAGIC)
+	{
+		header->format = DIR_FORMAT_FIXED;
+		header->size = DIR_FIXED_HEADER_SIZE;
+		header->numEntries = firstItem;
+		header->indexInode = 0;
+		header->indexUsed = 0;
+		return;
+	}
+	header->format = firstItem == DIR_COMPACT_MAGIC ? DIR_FORMAT_COMPACT : DIR_FORMAT_FIXED;
+	header->size = DIR_HEADER_SIZE;
+	char2ul((unsigned char *)&buf[sizeof(unsigned int)], &header->numEntries);
+	char2ul((unsigned char *)&buf[2 * sizeof(unsigned int)], &header->indexInode);
+	char2ul((unsigned char *)&buf[3 * sizeof(unsigned int)], &header->indexUsed);
+}
+
+void encodeDirHeader(DirHeader *header, unsigned char *buf)
+{
+	ul2char(DIR_COMPACT_MAGIC, buf);
+	ul2char(header->numEntries, &buf[sizeof(unsigned int)]);
+	ul2char(header->indexInode, &buf[2 * sizeof(unsigned int)]);
+	ul2char(header->indexUsed, &buf[3 * sizeof(unsigned int)]);
+}
+
+// Le o registro na posicao pos de um trecho. Retorna 0 se bem sucedido ou
+// -1 se o registro estiver corrompido
+int decodeDirRecord(const unsigned char *chunk, unsigned int pos, unsigned int *inodeNumber, unsigned int *length,
+					unsigned int *nameLength)
+{
+	char2ul((unsigned char *)&chunk[pos], inodeNumber);
+	*length = chunk[pos + 4] | (chunk[pos + 5] << 8);
+	*nameLength = chunk[pos + 6];
+	if (*length < dirRecordSize(0) || *length % 4 != 0 || pos + *length > DIR_CHUNK_SIZE)
+		return -1;
+	if (*inodeNumber != 0 && (*nameLength == 0 || dirRecordSize(*nameLength) > *length))
+		return -1;
+	return 0;
+}
+
+void setDirRecordLength(unsigned char *chunk, unsigned int pos, unsigned int length)
+{
+	chunk[pos + 4] = length & 0xFF;
+	chunk[pos + 5] = length >> 8;
+}
+
+void encodeDirRecord(unsigned char *chunk, unsigned int pos, unsigned int inodeNumber, unsigned int length,
+					 const char *name, unsigned int nameLength)
+{
+	ul2char(inodeNumber, &chunk[pos]);
+	setDirRecordLength(chunk, pos, length);
+	chunk[pos + 6] = nameLength;
+	memcpy(&chunk[pos + DIR_RECORD_HEADER_SIZE], name, nameLength);
+}
+
+// Devolve os enderecos dos blocos da arvore de nomes tree, em *numBlocks, a
+// partir do mapa em memoria, que e' refeito com uma unica passagem pela
+// cadeia de extensoes quando a arvore muda de tamanho. Retorna NULL se
+// faltar memoria
+unsigned int *mapDirTree(Inode *tree, unsigned int *numBlocks)
+{
+	unsigned int inodeNumber = inodeGetNumber(tree);
+	*numBlocks = divideCeil(inodeGetFileSize(tree), superblock[SUPERBLOCK_ITEM_BLOCKSIZE]);
+	DirTreeMap *map = &dirTreeMaps[0];
+	for (unsigned int i = 0; i < DIR_TREE_MAP_CACHE_SIZE; i++)
+		if (dirTreeMaps[i].inodeNumber == inodeNumber)
+		{
+			map = &dirTreeMaps[i];
+			break;
+		}
+		else if (dirTreeMaps[i].lastUse < map->lastUse)
+			map = &dirTreeMaps[i];
+	map->lastUse = ++dirTreeMapClock;
+	if (map->inodeNumber == inodeNumber && map->numBlocks == *numBlocks)
+		return map->blockAddrs;
+
+	unsigned int *blockAddrs = realloc(map->blockAddrs, (*numBlocks + 1) * sizeof(unsigned int));
+	if (blockAddrs == NULL)
+	{
+		forgetDirTreeMap(map->inodeNumber);
+		return NULL;
+	}
+	unsigned int numMapped = inodeGetBlockAddrs(tree, 0, *numBlocks, blockAddrs);
+	memset(&blockAddrs[numMapped], 0, (*numBlocks - numMapped) * sizeof(unsigned int));
+	map->inodeNumber = inodeNumber;
+	map->numBlocks = *numBlocks;
+	map->blockAddrs = blockAddrs;
+	return blockAddrs;
+}
+
+// Descarta o mapa de blocos da arvore de nomes no i-node inodeNumber, ou de
+// todas as arvores se inodeNumber for 0
+void forgetDirTreeMap(unsigned int inodeNumber)
+{
+	for (unsigned int i = 0; i < DIR_TREE_MAP_CACHE_SIZE; i++)
+		if (inodeNumber == 0 || dirTreeMaps[i].inodeNumber == inodeNumber)
+		{
+			free(dirTreeMaps[i].blockAddrs);
+			dirTreeMaps[i].blockAddrs = NULL;
+			dirTreeMaps[i].inodeNumber = 0;
+			dirTreeMaps[i].numBlocks = 0;
+		}
+}
+
+// Le (write = 0) ou grava nbytes do conteudo de um diretorio, ou de seu
+// indice, a partir de offset, alterando diretamente os blocos em cache. Os
+// blocos da arvore de nomes sao localizados pelo seu mapa em memoria.
+// Retorna 0 se bem sucedido ou -1 caso contrario
+int transferDirBytes(Inode *inodeDir, unsigned int offset, unsigned char *buf, unsigned int nbytes, int write)
+{
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned int numMapped = 0;
+	unsigned int *blockAddrs = NULL;
+	if (inodeGetFileType(inodeDir) == FILETYPE_DIRTREE && (blockAddrs = mapDirTree(inodeDir, &numMapped)) == NULL)
+		return -1;
+	unsigned int done = 0;
+	while (done < nbytes)
+	{
+		unsigned int blockOffset = (offset + done) % blockSize;
+		unsigned int size = blockSize - blockOffset;
+		if (size > nbytes - done)
+			size = nbytes - done;
+		unsigned int blockNum = (offset + done) / blockSize;
+		unsigned int blockAddr = 0;
+		if (blockAddrs == NULL)
+			blockAddr = inodeGetBlockAddr(inodeDir, blockNum);
+		else if (blockNum < numMapped)
+			blockAddr = blockAddrs[blockNum];
+		unsigned char *blockData = blockAddr != 0 ? cachePin(blockAddr, 1) : NULL;
+		if (blockData == NULL)
+			return -1;
+		if (write)
+			memcpy(&blockData[blockOffset], &buf[done], size);
+		else
+			memcpy(&buf[done], &blockData[blockOffset], size);
+		cacheUnpin(blockAddr, write);
+		done += size;
+	}
+	return 0;
+}
+
+// Fixa em cache o bloco com o trecho do diretorio que comeca em chunkOffset
+// e devolve o inicio do trecho, ou NULL em caso de falha. O bloco, cujo
+// endereco e' copiado para *blockAddr, deve ser liberado com cacheUnpin
+unsigned char *pinDirChunk(Inode *inodeDir, unsigned int chunkOffset, unsigned int *blockAddr)
+{
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	*blockAddr = inodeGetBlockAddr(inodeDir, chunkOffset / blockSize);
+	unsigned char *blockData = *blockAddr != 0 ? cachePin(*blockAddr, 1) : NULL;
+	if (blockData == NULL)
+		return NULL;
+	return &blockData[chunkOffset % blockSize];
+}
+
+int readDirHeader(Inode *inodeDir, DirHeader *header)
+{
+	unsigned char buf[DIR_HEADER_SIZE];
+	if (inodeGetFileType(inodeDir) != FILETYPE_DIR)
+		return -1;
+	if (transferDirBytes(inodeDir, 0, buf, DIR_HEADER_SIZE, 0) == -1)
+		return -1;
+	decodeDirHeader(buf, header);
+	return 0;
+}
+
+// Grava o cabecalho de um diretorio no formato compacto
+int writeDirHeader(Inode *inodeDir, DirHeader *header)
+{
+	unsigned char buf[DIR_HEADER_SIZE];
+	encodeDirHeader(header, buf);
+	return transferDirBytes(inodeDir, 0, buf, DIR_HEADER_SIZE, 1);
+}
+
+// Le a primeira entrada em uso do diretorio a partir da posicao *offset,
+// que passa a ser a posicao da entrada, e copia seu nome, terminado em '\0',
+// para name. Retorna 1 se encontrada, 0 no fim do diretorio ou -1 em caso de
+// falha
+int readNextDirEntry(Inode *inodeDir, DirHeader *header, unsigned int *offset, unsigned int *inodeNumber, char *name)
+{
+	if (header->format == DIR_FORMAT_FIXED)
+	{
+		unsigned int index = *offset > header->size ? divideCeil(*offset - header->size, DIR_FIXED_ENTRY_SIZE) : 0;
+		if (index >= header->numEntries)
+			return 0;
+		unsigned char entry[DIR_FIXED_ENTRY_SIZE];
+		*offset = header->size + index * DIR_FIXED_ENTRY_SIZE;
+		if (transferDirBytes(inodeDir, *offset, entry, DIR_FIXED_ENTRY_SIZE, 0) == -1)
+			return -1;
+		char2ul(entry, inodeNumber);
+		memcpy(name, &entry[sizeof(unsigned int)], MAX_FILENAME_LENGTH);
+		name[MAX_FILENAME_LENGTH] = '\0';
+		return 1;
+	}
+	// o trecho e' percorrido desde o inicio, pois *offset pode estar dentro
+	// de um registro que absorveu o espaco de outro removido
+	unsigned int size = inodeGetFileSize(inodeDir);
+	for (unsigned int chunkOffset = *offset - *offset % DIR_CHUNK_SIZE; chunkOffset < size; chunkOffset += DIR_CHUNK_SIZE)
+	{
+		unsigned int blockAddr, length, nameLength;
+		unsigned char *chunk = pinDirChunk(inodeDir, chunkOffset, &blockAddr);
+		if (chunk == NULL)
+			return -1;
+		for (unsigned int pos = dirChunkStart(chunkOffset); pos < DIR_CHUNK_SIZE; pos += length)
+		{
+			if (decodeDirRecord(chunk, pos, inodeNumber, &length, &nameLength) == -1)
+			{
+				cacheUnpin(blockAddr, 0);
+				return -1;
+			}
+			if (*inodeNumber != 0 && chunkOffset + pos >= *offset)
+			{
+				memcpy(name, &chunk[pos + DIR_RECORD_HEADER_SIZE], nameLength);
+				name[nameLength] = '\0';
+				cacheUnpin(blockAddr, 0);
+				*offset = chunkOffset + pos;
+				return 1;
+			}
+		}
+		cacheUnpin(blockAddr, 0);
+	}
+	return 0;
+}
+
+// Acrescenta uma entrada a um diretorio em carregamento, copiando o nome
+// para *names, que avanca. Retorna 0 se bem sucedido ou -1 se o diretorio
+// ja tiver as capacity entradas previstas
+int appendLoadedEntry(Directory *dir, unsigned int capacity, char **names, const char *name, unsigned int nameLength,
+					  unsigned int inodeNumber, unsigned int offset)
+{
+	if (dir->numEntries == capacity)
+		return -1;
+	DirectoryEntry *entry = &dir->entries[dir->numEntries++];
+	memcpy(*names, name, nameLength);
+	(*names)[nameLength] = '\0';
+	entry->name = *names;
+	entry->nameLength = nameLength;
+	entry->inodeNumber = inodeNumber;
+	entry->offset = offset;
+	*names += nameLength + 1;
+	return 0;
+}
+
+// Carrega todas as entradas de um diretorio, lidas direto dos blocos em
+// cache. A area de nomes e' dimensionada pelo tamanho do diretorio, ja que
+// cada nome, com o '\0', cabe no seu registro. Retorna o diretorio, a ser
+// liberado com freeDirectory, ou NULL em caso de falha
+Directory *loadDirectory(Disk *d, Inode *inode)
+{
+	DirHeader header;
+	if (readDirHeader(inode, &header) == -1)
+		return NULL;
+	unsigned long namesSize = header.format == DIR_FORMAT_COMPACT ? inodeGetFileSize(inode)
+																  : (unsigned long)header.numEntries * (MAX_FILENAME_LENGTH + 1);
+	Directory *dir = malloc(sizeof(Directory) + header.numEntries * sizeof(DirectoryEntry) + namesSize);
+	if (dir == NULL)
+		return NULL;
+	dir->numEntries = 0;
+	char *names = (char *)&dir->entries[header.numEntries];
+	unsigned int inodeNumber;
+	int ret = 0;
+	if (header.format == DIR_FORMAT_COMPACT)
+	{
+		unsigned int size = inodeGetFileSize(inode);
+		for (unsigned int chunkOffset = 0; chunkOffset < size && ret == 0; chunkOffset += DIR_CHUNK_SIZE)
+		{
+			unsigned int blockAddr, length, nameLength;
+			unsigned char *chunk = pinDirChunk(inode, chunkOffset, &blockAddr);
+			if (chunk == NULL)
+			{
+				ret = -1;
+				break;
+			}
+			for (unsigned int pos = dirChunkStart(chunkOffset); pos < DIR_CHUNK_SIZE && ret == 0; pos += length)
+			{
+				ret = decodeDirRecord(chunk, pos, &inodeNumber, &length, &nameLength);
+				if (ret == 0 && inodeNumber != 0)
+					ret = appendLoadedEntry(dir, header.numEntries, &names, (char *)&chunk[pos + DIR_RECORD_HEADER_SIZE],
+											nameLength, inodeNumber, chunkOffset + pos);
+			}
+			cacheUnpin(blockAddr, 0);
+		}
+	}
+	else
+	{
+		char name[MAX_FILENAME_LENGTH + 1];
+		unsigned int offset = 0;
+		while ((ret = readNextDirEntry(inode, &header, &offset, &inodeNumber, name)) == 1)
+			if (appendLoadedEntry(dir, header.numEntries, &names, name, strlen(name), inodeNumber, offset++) == -1)
+				break;
+	}
+	if (ret != 0 || dir->numEntries != header.numEntries)
+	{
+		freeDirectory(dir);
+		return NULL;
+	}
+	return dir;
+}
+
+// Aumenta em nbytes o tamanho de um diretorio, ou de seu indice, alocando e
+// zerando os blocos que passarem a ser necessarios, contiguos ao ultimo
+// sempre que possivel. Retorna 0 se bem sucedido ou -1 caso contrario
+int growDirectory(Disk *d, Inode *inodeDir, unsigned int nbytes)
+{
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned int size = inodeGetFileSize(inodeDir);
+	unsigned int numBlocks = divideCeil(size, blockSize);
+	unsigned int numNew = divideCeil(size + nbytes, blockSize) - numBlocks;
+	if (numNew > 0)
+	{
+		unsigned int *blocks = malloc(numNew * sizeof(unsigned int));
+		unsigned int goal = numBlocks > 0 ? inodeGetBlockAddr(inodeDir, numBlocks - 1) + 1 : 0;
+		if (blocks == NULL || allocateBlocks(d, goal, numNew, blocks) == -1)
+		{
+			free(blocks);
+			return -1;
+		}
+		unsigned int numAdded = 0;
+		for (; numAdded < numNew; numAdded++)
+		{
+			unsigned char *blockData = cachePin(blocks[numAdded], 0);
+			if (blockData == NULL)
+				break;
+			memset(blockData, 0, blockSize);
+			cacheUnpin(blocks[numAdded], 1);
+			if (setInodeBlock(inodeDir, numBlocks + numAdded, numBlocks + numAdded, blocks[numAdded]) == -1)
+				break;
+		}
+		setBlocksStatus(numAdded, blocks, 1);
+		free(blocks);
+		if (saveBitmap(d) == -1 || numAdded != numNew)
+			return -1;
+	}
+	inodeSetFileSize(inodeDir, size + nbytes);
+	return inodeSave(inodeDir);
+}
+
+// Reduz um diretorio para newSize bytes. Os blocos que deixarem de ser
+// usados sao enfileirados para recuperacao. Retorna 0 se bem sucedido ou -1
+// caso contrario
+int shrinkDirectory(Inode *inodeDir, unsigned int newSize)
+{
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned int numBlocks = divideCeil(newSize, blockSize);
+	if (numBlocks < divideCeil(inodeGetFileSize(inodeDir), blockSize))
+	{
+		unsigned int *addrs = malloc(inodeNumItemsPerExtension() * sizeof(unsigned int));
+		unsigned int chain = 0;
+		int numAddrs = addrs != NULL ? inodeTruncateBlocks(inodeDir, numBlocks, addrs, &chain) : -1;
+		if (numAddrs == -1 || queueReclaim(numAddrs, addrs, chain) == -1)
+		{
+			free(addrs);
+			return -1;
+		}
+		free(addrs);
+	}
+	inodeSetFileSize(inodeDir, newSize);
+	return inodeSave(inodeDir);
+}
+
+// Insere o registro de uma entrada no primeiro trecho com espaco livre ou,
+// se nenhum tiver, em um novo trecho no fim do diretorio. Em diretorios com
+// indice so o ultimo trecho e' examinado, para que a insercao nao percorra
+// o diretorio. A posicao do registro e' copiada para *entryOffset. Retorna 0
+// se bem sucedido ou -1 caso contrario
+int insertDirRecord(Disk *d, Inode *inodeDir, DirHeader *header, unsigned int inodeNumber, const char *name,
+					unsigned int *entryOffset)
+{
+	unsigned int nameLength = strlen(name);
+	unsigned int needed = dirRecordSize(nameLength);
+	unsigned int size = inodeGetFileSize(inodeDir);
+	unsigned int blockAddr;
+	unsigned char *chunk;
+	for (unsigned int chunkOffset = header->indexInode != 0 ? size - DIR_CHUNK_SIZE : 0; chunkOffset < size; chunkOffset += DIR_CHUNK_SIZE)
+	{
+		if ((chunk = pinDirChunk(inodeDir, chunkOffset, &blockAddr)) == NULL)
+			return -1;
+		unsigned int recordInode, length, recordNameLength;
+		for (unsigned int pos = dirChunkStart(chunkOffset); pos < DIR_CHUNK_SIZE; pos += length)
+		{
+			if (decodeDirRecord(chunk, pos, &recordInode, &length, &recordNameLength) == -1)
+			{
+				cacheUnpin(blockAddr, 0);
+				return -1;
+			}
+			unsigned int used = recordInode != 0 ? dirRecordSize(recordNameLength) : 0;
+			if (length - used >= needed)
+			{
+				if (used > 0)
+					setDirRecordLength(chunk, pos, used);
+				encodeDirRecord(chunk, pos + used, inodeNumber, length - used, name, nameLength);
+				cacheUnpin(blockAddr, 1);
+				*entryOffset = chunkOffset + pos + used;
+				return 0;
+			}
+		}
+		cacheUnpin(blockAddr, 0);
+	}
+	if (growDirectory(d, inodeDir, DIR_CHUNK_SIZE) == -1 || (chunk = pinDirChunk(inodeDir, size, &blockAddr)) == NULL)
+		return -1;
+	encodeDirRecord(chunk, 0, inodeNumber, DIR_CHUNK_SIZE, name, nameLength);
+	cacheUnpin(blockAddr, 1);
+	*entryOffset = size;
+	return 0;
+}
+
+// Remove o registro na posicao offset, juntando seu espaco ao do registro
+// anterior do trecho ou, se for o primeiro, marcando-o como livre. Retorna 0
+// se bem sucedido ou -1 caso contrario
+int removeDirRecord(Inode *inodeDir, unsigned int offset)
+{
+	unsigned int chunkOffset = offset - offset % DIR_CHUNK_SIZE;
+	unsigned int target = offset % DIR_CHUNK_SIZE;
+	unsigned int blockAddr;
+	unsigned char *chunk = pinDirChunk(inodeDir, chunkOffset, &blockAddr);
+	if (chunk == NULL)
+		return -1;
+	unsigned int inodeNumber, length, nameLength, previous = 0, previousLength = 0;
+	unsigned int pos = dirChunkStart(chunkOffset);
+	int ret = 0;
+	while (ret == 0 && pos < target)
+	{
+		ret = decodeDirRecord(chunk, pos, &inodeNumber, &length, &nameLength);
+		previous = pos;
+		previousLength = length;
+		pos += length;
+	}
+	if (ret == 0 && (pos != target || decodeDirRecord(chunk, pos, &inodeNumber, &length, &nameLength) == -1 || inodeNumber == 0))
+		ret = -1;
+	if (ret == 0)
+	{
+		if (pos > dirChunkStart(chunkOffset))
+			setDirRecordLength(chunk, previous, previousLength + length);
+		else
+			ul2char(0, &chunk[pos]);
+	}
+	cacheUnpin(blockAddr, ret == 0);
+	return ret;
+}
+
+// Verifica se o trecho que comeca em chunkOffset esta vazio, isto e', tem
+// um unico registro livre. Retorna 1 se vazio, 0 se nao ou -1 em caso de
+// falha
+int dirChunkIsEmpty(Inode *inodeDir, unsigned int chunkOffset)
+{
+	unsigned int blockAddr, inodeNumber, length, nameLength;
+	unsigned char *chunk = pinDirChunk(inodeDir, chunkOffset, &blockAddr);
+	if (chunk == NULL)
+		return -1;
+	unsigned int pos = dirChunkStart(chunkOffset);
+	int ret = decodeDirRecord(chunk, pos, &inodeNumber, &length, &nameLength);
+	if (ret == 0)
+		ret = inodeNumber == 0 && pos + length == DIR_CHUNK_SIZE;
+	cacheUnpin(blockAddr, 0);
+	return ret;
+}
+
+// Hash FNV-1a do nome de uma entrada
+unsigned int dirNameHash(const char *name)
+{
+	unsigned int hash = 2166136261u;
+	for (; *name != '\0'; name++)
+		hash = (hash ^ (unsigned char)*name) * 16777619u;
+	return hash;
+}
+
+int readDirIndexSlot(Inode *dirIndex, unsigned int slot, unsigned int *hash, unsigned int *offset)
+{
+	unsigned char buf[DIR_INDEX_SLOT_SIZE];
+	if (transferDirBytes(dirIndex, slot * DIR_INDEX_SLOT_SIZE, buf, DIR_INDEX_SLOT_SIZE, 0) == -1)
+		return -1;
+	char2ul(buf, hash);
+	char2ul(&buf[sizeof(unsigned int)], offset);
+	return 0;
+}
+
+// Procura a entrada name no indice de hash de versoes anteriores. Retorna 1
+// se encontrada, com a posicao da entrada no diretorio em *offset e seu
+// i-node em *inodeNumber, 0 se nao encontrada ou -1 em caso de falha. Apenas
+// entradas com o mesmo hash sao lidas
+int probeDirIndex(Inode *inodeDir, DirHeader *header, Inode *dirIndex, const char *name, unsigned int *offset,
+				  unsigned int *inodeNumber)
+{
+	unsigned int numSlots = inodeGetFileSize(dirIndex) / DIR_INDEX_SLOT_SIZE;
+	unsigned int hash = dirNameHash(name);
+	unsigned int current = hash & (numSlots - 1);
+	for (unsigned int n = 0; n < numSlots; n++, current = (current + 1) & (numSlots - 1))
+	{
+		unsigned int slotHash, slotOffset;
+		if (readDirIndexSlot(dirIndex, current, &slotHash, &slotOffset) == -1)
+			return -1;
+		if (slotOffset == DIR_INDEX_EMPTY)
+			return 0;
+		if (slotOffset == DIR_INDEX_DELETED || slotHash != hash)
+			continue;
+		char entryName[MAX_FILENAME_LENGTH + 1];
+		unsigned int entryOffset = slotOffset;
+		if (readNextDirEntry(inodeDir, header, &entryOffset, inodeNumber, entryName) != 1 || entryOffset != slotOffset)
+			return -1;
+		if (strcmp(entryName, name) == 0)
+		{
+			*offset = slotOffset;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+unsigned int dirTreeNodeItem(const unsigned char *node, unsigned int item)
+{
+	unsigned int value;
+	char2ul((unsigned char *)&node[item * sizeof(unsigned int)], &value);
+	return value;
+}
+
+void setDirTreeNodeItem(unsigned char *node, unsigned int item, unsigned int value)
+{
+	ul2char(value, &node[item * sizeof(unsigned int)]);
+}
+
+void initDirTreeNode(unsigned char *node, unsigned int next, unsigned int leaf)
+{
+	memset(node, 0, DIR_TREE_NODE_SIZE);
+	setDirTreeNodeItem(node, DIR_TREE_NODE_NEXT, next);
+	setDirTreeNodeItem(node, DIR_TREE_NODE_USED, DIR_TREE_NODE_HEADER_SIZE);
+	setDirTreeNodeItem(node, DIR_TREE_NODE_LEAF, leaf);
+}
+
+unsigned int dirTreeKeySize(unsigned int nameLength)
+{
+	return DIR_TREE_KEY_HEADER_SIZE + nameLength;
+}
+
+unsigned int dirTreeKeyNameLength(const unsigned char *node, unsigned int pos)
+{
+	return node[pos + 2 * sizeof(unsigned int)];
+}
+
+const char *dirTreeKeyName(const unsigned char *node, unsigned int pos)
+{
+	return (const char *)&node[pos + DIR_TREE_KEY_HEADER_SIZE];
+}
+
+void decodeDirTreeKey(const unsigned char *node, unsigned int pos, unsigned int *value, unsigned int *offset)
+{
+	char2ul((unsigned char *)&node[pos], value);
+	char2ul((unsigned char *)&node[pos + sizeof(unsigned int)], offset);
+}
+
+void encodeDirTreeKey(unsigned char *node, unsigned int pos, unsigned int value, unsigned int offset, const char *name,
+					  unsigned int nameLength)
+{
+	ul2char(value, &node[pos]);
+	ul2char(offset, &node[pos + sizeof(unsigned int)]);
+	node[pos + 2 * sizeof(unsigned int)] = nameLength;
+	memcpy(&node[pos + DIR_TREE_KEY_HEADER_SIZE], name, nameLength);
+}
+
+// Compara a chave na posicao pos de um no com name, byte a byte, com o
+// nome mais curto antes quando um e' prefixo do outro
+int compareDirTreeKey(const unsigned char *node, unsigned int pos, const char *name, unsigned int nameLength)
+{
+	unsigned int keyLength = dirTreeKeyNameLength(node, pos);
+	int cmp = memcmp(dirTreeKeyName(node, pos), name, keyLength < nameLength ? keyLength : nameLength);
+	if (cmp != 0)
+		return cmp;
+	return keyLength < nameLength ? -1 : keyLength > nameLength;
+}
+
+// Procura em um no a primeira chave maior ou igual a name, cuja posicao e'
+// escrita em *pos (o fim das chaves, se nao houver). Retorna 1 se a chave e'
+// igual a name, 0 se nao ou -1 se o no estiver corrompido
+int findDirTreeKey(const unsigned char *node, const char *name, unsigned int nameLength, unsigned int *pos)
+{
+	unsigned int used = dirTreeNodeItem(node, DIR_TREE_NODE_USED);
+	if (used < DIR_TREE_NODE_HEADER_SIZE || used > DIR_TREE_NODE_SIZE)
+		return -1;
+	for (*pos = DIR_TREE_NODE_HEADER_SIZE; *pos < used; *pos += dirTreeKeySize(dirTreeKeyNameLength(node, *pos)))
+	{
+		if (*pos + DIR_TREE_KEY_HEADER_SIZE > used ||
+			*pos + dirTreeKeySize(dirTreeKeyNameLength(node, *pos)) > used)
+			return -1;
+		int cmp = compareDirTreeKey(node, *pos, name, nameLength);
+		if (cmp >= 0)
+			return cmp == 0;
+	}
+	return 0;
+}
+
+int readDirTreeNode(Inode *tree, unsigned int nodeNumber, unsigned char *node)
+{
+	return transferDirBytes(tree, nodeNumber * DIR_TREE_NODE_SIZE, node, DIR_TREE_NODE_SIZE, 0);
+}
+
+int writeDirTreeNode(Inode *tree, unsigned int nodeNumber, unsigned char *node)
+{
+	return transferDirBytes(tree, nodeNumber * DIR_TREE_NODE_SIZE, node, DIR_TREE_NODE_SIZE, 1);
+}
+
+int readDirTreeHeader(Inode *tree, DirTreeHeader *header)
+{
+	unsigned char buf[DIR_TREE_HEADER_SIZE];
+	if (transferDirBytes(tree, 0, buf, DIR_TREE_HEADER_SIZE, 0) == -1)
+		return -1;
+	unsigned int magic;
+	char2ul(buf, &magic);
+	char2ul(&buf[sizeof(unsigned int)], &header->root);
+	char2ul(&buf[2 * sizeof(unsigned int)], &header->numNodes);
+	char2ul(&buf[3 * sizeof(unsigned int)], &header->height);
+	if (magic != DIR_TREE_MAGIC || header->height == 0 || header->height > DIR_TREE_MAX_HEIGHT)
+		return -1;
+	return 0;
+}
+
+void encodeDirTreeHeader(DirTreeHeader *header, unsigned char *buf)
+{
+	ul2char(DIR_TREE_MAGIC, buf);
+	ul2char(header->root, &buf[sizeof(unsigned int)]);
+	ul2char(header->numNodes, &buf[2 * sizeof(unsigned int)]);
+	ul2char(header->height, &buf[3 * sizeof(unsigned int)]);
+}
+
+int writeDirTreeHeader(Inode *tree, DirTreeHeader *header)
+{
+	unsigned char buf[DIR_TREE_HEADER_SIZE];
+	encodeDirTreeHeader(header, buf);
+	return transferDirBytes(tree, 0, buf, DIR_TREE_HEADER_SIZE, 1);
+}
+
+// Desce da raiz ate a folha onde name esta ou deveria estar, lida em node,
+// guardando em path os nos percorridos, da raiz (path[0]) ate a folha.
+// Retorna 0 se bem sucedido ou -1 caso contrario
+int descendDirTree(Inode *tree, DirTreeHeader *header, const char *name, unsigned int nameLength, unsigned int *path,
+				   unsigned char *node)
+{
+	unsigned int nodeNumber = header->root;
+	for (unsigned int level = 0; level < header->height; level++)
+	{
+		if (nodeNumber == 0 || nodeNumber >= header->numNodes || readDirTreeNode(tree, nodeNumber, node) == -1)
+			return -1;
+		path[level] = nodeNumber;
+		int leaf = dirTreeNodeItem(node, DIR_TREE_NODE_LEAF);
+		if (leaf != (level == header->height - 1))
+			return -1;
+		if (leaf)
+			return 0;
+		// o filho seguido e' o da ultima chave menor ou igual a name
+		unsigned int pos, offset;
+		int found = findDirTreeKey(node, name, nameLength, &pos);
+		if (found == -1)
+			return -1;
+		if (found == 1)
+			decodeDirTreeKey(node, pos, &nodeNumber, &offset);
+		else if (pos == DIR_TREE_NODE_HEADER_SIZE)
+			nodeNumber = dirTreeNodeItem(node, DIR_TREE_NODE_NEXT);
+		else
+		{
+			unsigned int prev = DIR_TREE_NODE_HEADER_SIZE;
+			while (prev + dirTreeKeySize(dirTreeKeyNameLength(node, prev)) < pos)
+				prev += dirTreeKeySize(dirTreeKeyNameLength(node, prev));
+			decodeDirTreeKey(node, prev, &nodeNumber, &offset);
+		}
+	}
+	return -1;
+}
+
+// Procura name na arvore de nomes. Retorna 1 se encontrada, com seu i-node
+// em *inodeNumber e a posicao de seu registro em *offset, 0 se nao existir
+// ou -1 em caso de falha
+int lookupDirTree(Inode *tree, const char *name, unsigned int *inodeNumber, unsigned int *offset)
+{
+	DirTreeHeader header;
+	unsigned int path[DIR_TREE_MAX_HEIGHT];
+	unsigned char node[DIR_TREE_NODE_SIZE];
+	unsigned int nameLength = strlen(name), pos;
+	if (readDirTreeHeader(tree, &header) == -1 || descendDirTree(tree, &header, name, nameLength, path, node) == -1)
+		return -1;
+	int found = findDirTreeKey(node, name, nameLength, &pos);
+	if (found == 1)
+		decodeDirTreeKey(node, pos, inodeNumber, offset);
+	return found;
+}
+
+// Acrescenta um no vazio ao fim da arvore, cujo numero e' escrito em
+// *nodeNumber. Retorna 0 se bem sucedido ou -1 caso contrario
+int newDirTreeNode(Disk *d, Inode *tree, DirTreeHeader *header, unsigned int *nodeNumber)
+{
+	if (growDirectory(d, tree, DIR_TREE_NODE_SIZE) == -1)
+		return -1;
+	*nodeNumber = header->numNodes++;
+	return 0;
+}
+
+// Insere a chave key, com value e offset, na posicao pos do no nodeNumber,
+// ja lido em node, e grava o no. Se a chave nao couber, a metade final das
+// chaves passa para um novo no, e a chave que deve subir para o pai, com o
+// numero do novo no, e' devolvida em key e *value. Retorna 1 se o no foi
+// dividido, 0 se nao ou -1 em caso de falha
+int putDirTreeKey(Disk *d, Inode *tree, DirTreeHeader *header, unsigned int nodeNumber, unsigned char *node,
+				  unsigned int pos, char *key, unsigned int *value, unsigned int offset)
+{
+	unsigned int keyLength = strlen(key);
+	unsigned int keySize = dirTreeKeySize(keyLength);
+	unsigned int used = dirTreeNodeItem(node, DIR_TREE_NODE_USED);
+	unsigned int numKeys = dirTreeNodeItem(node, DIR_TREE_NODE_NUMKEYS);
+	if (used + keySize <= DIR_TREE_NODE_SIZE)
+	{
+		memmove(&node[pos + keySize], &node[pos], used - pos);
+		encodeDirTreeKey(node, pos, *value, offset, key, keyLength);
+		setDirTreeNodeItem(node, DIR_TREE_NODE_NUMKEYS, numKeys + 1);
+		setDirTreeNodeItem(node, DIR_TREE_NODE_USED, used + keySize);
+		return writeDirTreeNode(tree, nodeNumber, node) == 0 ? 0 : -1;
+	}
+
+	// as chaves, com a nova, sao montadas em sequencia e divididas ao meio
+	unsigned char *keys = malloc(used + keySize);
+	unsigned int rightNode;
+	if (keys == NULL || newDirTreeNode(d, tree, header, &rightNode) == -1)
+	{
+		free(keys);
+		return -1;
+	}
+	unsigned int size = used - DIR_TREE_NODE_HEADER_SIZE + keySize;
+	unsigned int before = pos - DIR_TREE_NODE_HEADER_SIZE;
+	memcpy(keys, &node[DIR_TREE_NODE_HEADER_SIZE], before);
+	encodeDirTreeKey(keys, before, *value, offset, key, keyLength);
+	memcpy(&keys[before + keySize], &node[pos], used - pos);
+	numKeys++;
+	unsigned int split = 0, last = 0, leftKeys = 0;
+	while (split < size && (leftKeys == 0 || split < size / 2))
+	{
+		last = split;
+		split += dirTreeKeySize(dirTreeKeyNameLength(keys, split));
+		leftKeys++;
+	}
+	int leaf = dirTreeNodeItem(node, DIR_TREE_NODE_LEAF);
+	// cada lado fica com ao menos uma chave; no no interno, a chave do meio
+	// sobe para o pai sem ficar em nenhum dos dois
+	if (split == size || (!leaf && split + dirTreeKeySize(dirTreeKeyNameLength(keys, split)) == size))
+	{
+		split = last;
+		leftKeys--;
+	}
+	unsigned int middleValue, middleOffset, middleLength = dirTreeKeyNameLength(keys, split);
+	decodeDirTreeKey(keys, split, &middleValue, &middleOffset);
+	memcpy(key, dirTreeKeyName(keys, split), middleLength);
+	key[middleLength] = '\0';
+
+	unsigned char right[DIR_TREE_NODE_SIZE];
+	unsigned int rightStart = split;
+	if (leaf)
+	{
+		// a nova folha entra na lista encadeada logo apos a original
+		initDirTreeNode(right, dirTreeNodeItem(node, DIR_TREE_NODE_NEXT), 1);
+		setDirTreeNodeItem(node, DIR_TREE_NODE_NEXT, rightNode);
+	}
+	else
+	{
+		initDirTreeNode(right, middleValue, 0);
+		rightStart += dirTreeKeySize(middleLength);
+		numKeys--;
+	}
+	memcpy(&right[DIR_TREE_NODE_HEADER_SIZE], &keys[rightStart], size - rightStart);
+	setDirTreeNodeItem(right, DIR_TREE_NODE_NUMKEYS, numKeys - leftKeys);
+	setDirTreeNodeItem(right, DIR_TREE_NODE_USED, DIR_TREE_NODE_HEADER_SIZE + size - rightStart);
+	memset(&node[DIR_TREE_NODE_HEADER_SIZE], 0, DIR_TREE_NODE_SIZE - DIR_TREE_NODE_HEADER_SIZE);
+	memcpy(&node[DIR_TREE_NODE_HEADER_SIZE], keys, split);
+	setDirTreeNodeItem(node, DIR_TREE_NODE_NUMKEYS, leftKeys);
+	setDirTreeNodeItem(node, DIR_TREE_NODE_USED, DIR_TREE_NODE_HEADER_SIZE + split);
+	free(keys);
+	*value = rightNode;
+	if (writeDirTreeNode(tree, rightNode, right) == -1 || writeDirTreeNode(tree, nodeNumber, node) == -1)
+		return -1;
+	return 1;
+}
+
+// Insere name, com seu i-node e a posicao de seu registro, na arvore de
+// nomes. Nos cheios sao divididos da folha para cima, e a arvore ganha um
+// nivel quando a raiz se divide. Retorna 0 se bem sucedido ou -1 se o nome
+// ja existir ou em caso de falha
+int insertDirTree(Disk *d, Inode *tree, const char *name, unsigned int inodeNumber, unsigned int offset)
+{
+	DirTreeHeader header;
+	unsigned int path[DIR_TREE_MAX_HEIGHT];
+	unsigned char node[DIR_TREE_NODE_SIZE];
+	unsigned int nameLength = strlen(name), pos;
+	if (readDirTreeHeader(tree, &header) == -1 || descendDirTree(tree, &header, name, nameLength, path, node) == -1 ||
+		findDirTreeKey(node, name, nameLength, &pos) != 0)
+		return -1;
+	char key[MAX_FILENAME_LENGTH + 1];
+	strcpy(key, name);
+	unsigned int value = inodeNumber, numNodes = header.numNodes;
+	for (unsigned int level = header.height; level-- > 0;)
+	{
+		int ret = putDirTreeKey(d, tree, &header, path[level], node, pos, key, &value, level == header.height - 1 ? offset : 0);
+		if (ret == -1)
+			return -1;
+		if (ret == 0)
+			break;
+		if (level == 0)
+		{
+			// nova raiz, com a raiz anterior e o novo no como filhos
+			unsigned int root;
+			if (header.height == DIR_TREE_MAX_HEIGHT || newDirTreeNode(d, tree, &header, &root) == -1)
+				return -1;
+			initDirTreeNode(node, header.root, 0);
+			if (putDirTreeKey(d, tree, &header, root, node, DIR_TREE_NODE_HEADER_SIZE, key, &value, 0) == -1)
+				return -1;
+			header.root = root;
+			header.height++;
+			return writeDirTreeHeader(tree, &header);
+		}
+		if (readDirTreeNode(tree, path[level - 1], node) == -1 ||
+			findDirTreeKey(node, key, strlen(key), &pos) == -1)
+			return -1;
+	}
+	return header.numNodes != numNodes ? writeDirTreeHeader(tree, &header) : 0;
+}
+
+// Retira name da arvore de nomes. Apenas a folha e' alterada: folhas que
+// ficam vazias continuam na lista e sao puladas nas leituras. Retorna 0 se
+// bem sucedido ou -1 se o nome nao existir ou em caso de falha
+int removeDirTree(Inode *tree, const char *name)
+{
+	DirTreeHeader header;
+	unsigned int path[DIR_TREE_MAX_HEIGHT];
+	unsigned char node[DIR_TREE_NODE_SIZE];
+	unsigned int nameLength = strlen(name), pos;
+	if (readDirTreeHeader(tree, &header) == -1 || descendDirTree(tree, &header, name, nameLength, path, node) == -1 ||
+		findDirTreeKey(node, name, nameLength, &pos) != 1)
+		return -1;
+	unsigned int used = dirTreeNodeItem(node, DIR_TREE_NODE_USED);
+	unsigned int keySize = dirTreeKeySize(nameLength);
+	memmove(&node[pos], &node[pos + keySize], used - pos - keySize);
+	memset(&node[used - keySize], 0, keySize);
+	setDirTreeNodeItem(node, DIR_TREE_NODE_NUMKEYS, dirTreeNodeItem(node, DIR_TREE_NODE_NUMKEYS) - 1);
+	setDirTreeNodeItem(node, DIR_TREE_NODE_USED, used - keySize);
+	return writeDirTreeNode(tree, path[header.height - 1], node);
+}
+
+// Copia para entries ate maxEntries nomes da arvore, em ordem, a partir de
+// start (incluido apenas se inclusive), seguindo a lista de folhas. Com
+// prefix, a leitura para no primeiro nome que nao comeca por ele. Retorna o
+// numero de nomes copiados ou -1 em caso de falha
+int scanDirTree(Inode *tree, const char *start, int inclusive, const char *prefix, FSDirent *entries,
+				unsigned int maxEntries)
+{
+	DirTreeHeader header;
+	unsigned int path[DIR_TREE_MAX_HEIGHT];
+	unsigned char node[DIR_TREE_NODE_SIZE];
+	unsigned int startLength = strlen(start), pos;
+	if (readDirTreeHeader(tree, &header) == -1 || descendDirTree(tree, &header, start, startLength, path, node) == -1)
+		return -1;
+	int found = findDirTreeKey(node, start, startLength, &pos);
+	if (found == -1)
+		return -1;
+	if (found == 1 && !inclusive)
+		pos += dirTreeKeySize(startLength);
+	unsigned int prefixLength = prefix != NULL ? strlen(prefix) : 0;
+	unsigned int count = 0, visited = 0;
+	while (count < maxEntries)
+	{
+		if (pos >= dirTreeNodeItem(node, DIR_TREE_NODE_USED))
+		{
+			unsigned int next = dirTreeNodeItem(node, DIR_TREE_NODE_NEXT);
+			if (next == 0)
+				break;
+			if (next >= header.numNodes || ++visited >= header.numNodes || readDirTreeNode(tree, next, node) == -1)
+				return -1;
+			pos = DIR_TREE_NODE_HEADER_SIZE;
+			continue;
+		}
+		unsigned int nameLength = dirTreeKeyNameLength(node, pos), offset;
+		const char *name = dirTreeKeyName(node, pos);
+		if (prefix != NULL && (nameLength < prefixLength || memcmp(name, prefix, prefixLength) != 0))
+			break;
+		decodeDirTreeKey(node, pos, &entries[count].inumber, &offset);
+		memcpy(entries[count].name, name, nameLength);
+		entries[count].name[nameLength] = '\0';
+		count++;
+		pos += dirTreeKeySize(nameLength);
+	}
+	return count;
+}
+
+int compareDirectoryEntries(const void *a, const void *b)
+{
+	return strcmp(((const DirectoryEntry *)a)->name, ((const DirectoryEntry *)b)->name);
+}
+
+// Acrescenta um no a imagem em memoria de uma arvore, que cresce conforme
+// necessario. Retorna o no, cujo numero e' escrito em *nodeNumber, ou NULL
+// em caso de falha
+unsigned char *addDirTreeImageNode(unsigned char **image, unsigned int *capacity, DirTreeHeader *header,
+								   unsigned int *nodeNumber)
+{
+	if (header->numNodes == *capacity)
+	{
+		unsigned char *bigger = realloc(*image, 2 * *capacity * DIR_TREE_NODE_SIZE);
+		if (bigger == NULL)
+			return NULL;
+		*image = bigger;
+		*capacity *= 2;
+	}
+	*nodeNumber = header->numNodes++;
+	return &(*image)[*nodeNumber * DIR_TREE_NODE_SIZE];
+}
+
+// Monta em memoria a arvore de nomes das entradas de dir, ja ordenadas:
+// folhas cheias, encadeadas em ordem, e cada nivel interno sobre o anterior,
+// ate a raiz. Retorna a imagem, com o no 0 reservado para o cabecalho
+// descrito em header, ou NULL em caso de falha
+unsigned char *buildDirTreeImage(Directory *dir, DirTreeHeader *header)
+{
+	unsigned int capacity = 16;
+	unsigned char *image = malloc(capacity * DIR_TREE_NODE_SIZE);
+	// nos do nivel sendo montado e o primeiro nome de cada um
+	unsigned int *nodes = malloc((dir->numEntries + 1) * sizeof(unsigned int));
+	const char **firstNames = malloc((dir->numEntries + 1) * sizeof(const char *));
+	int ok = image != NULL && nodes != NULL && firstNames != NULL;
+	header->numNodes = 1;
+	header->height = 1;
+	unsigned int numNodes = 0, i = 0;
+	while (ok && (numNodes == 0 || i < dir->numEntries))
+	{
+		unsigned int nodeNumber;
+		unsigned char *node = addDirTreeImageNode(&image, &capacity, header, &nodeNumber);
+		if (node == NULL)
+		{
+			ok = 0;
+			break;
+		}
+		initDirTreeNode(node, 0, 1);
+		firstNames[numNodes] = i < dir->numEntries ? dir->entries[i].name : "";
+		nodes[numNodes++] = nodeNumber;
+		unsigned int pos = DIR_TREE_NODE_HEADER_SIZE, numKeys = 0;
+		for (; i < dir->numEntries && pos + dirTreeKeySize(dir->entries[i].nameLength) <= DIR_TREE_NODE_SIZE; i++)
+		{
+			DirectoryEntry *entry = &dir->entries[i];
+			encodeDirTreeKey(node, pos, entry->inodeNumber, entry->offset, entry->name, entry->nameLength);
+			pos += dirTreeKeySize(entry->nameLength);
+			numKeys++;
+		}
+		if (i < dir->numEntries)
+			setDirTreeNodeItem(node, DIR_TREE_NODE_NEXT, nodeNumber + 1);
+		setDirTreeNodeItem(node, DIR_TREE_NODE_NUMKEYS, numKeys);
+		setDirTreeNodeItem(node, DIR_TREE_NODE_USED, pos);
+	}
+	// cada nivel interno substitui o anterior no inicio dos vetores
+	while (ok && numNodes > 1)
+	{
+		unsigned int numParents = 0;
+		for (unsigned int child = 0; child < numNodes;)
+		{
+			unsigned int nodeNumber;
+			unsigned char *node = addDirTreeImageNode(&image, &capacity, header, &nodeNumber);
+			if (node == NULL)
+			{
+				ok = 0;
+				break;
+			}
+			initDirTreeNode(node, nodes[child], 0);
+			firstNames[numParents] = firstNames[child];
+			unsigned int pos = DIR_TREE_NODE_HEADER_SIZE, numKeys = 0;
+			for (child++; child < numNodes && pos + dirTreeKeySize(strlen(firstNames[child])) <= DIR_TREE_NODE_SIZE;
+				 child++)
+			{
+				unsigned int nameLength = strlen(firstNames[child]);
+				encodeDirTreeKey(node, pos, nodes[child], 0, firstNames[child], nameLength);
+				pos += dirTreeKeySize(nameLength);
+				numKeys++;
+			}
+			setDirTreeNodeItem(node, DIR_TREE_NODE_NUMKEYS, numKeys);
+			setDirTreeNodeItem(node, DIR_TREE_NODE_USED, pos);
+			nodes[numParents++] = nodeNumber;
+		}
+		numNodes = numParents;
+		header->height++;
+	}
+	if (ok)
+	{
+		header->root = nodes[0];
+		memset(image, 0, DIR_TREE_NODE_SIZE);
+		encodeDirTreeHeader(header, image);
+	}
+	free(nodes);
+	free(firstNames);
+	if (!ok)
+	{
+		free(image);
+		return NULL;
+	}
+	return image;
+}
+
+// Cria uma nova arvore de nomes para as entradas do diretorio e libera o
+// indice anterior, se houver. Retorna 0 se bem sucedido ou -1 caso
+// contrario, mantendo o indice anterior
+int buildDirIndex(Disk *d, Inode *inodeDir, DirHeader *header)
+{
+	Directory *dir = loadDirectory(d, inodeDir);
+	if (dir == NULL)
+		return -1;
+	qsort(dir->entries, dir->numEntries, sizeof(DirectoryEntry), compareDirectoryEntries);
+	DirTreeHeader treeHeader;
+	unsigned char *image = buildDirTreeImage(dir, &treeHeader);
+	freeDirectory(dir);
+	if (image == NULL)
+		return -1;
+	unsigned int inodeNumber = findFreeInode(d);
+	Inode *tree = inodeNumber != 0 ? inodeCreate(inodeNumber, d) : NULL;
+	if (tree == NULL)
+	{
+		free(image);
+		return -1;
+	}
+	inodeSetRefCount(tree, 1);
+	unsigned int size = treeHeader.numNodes * DIR_TREE_NODE_SIZE;
+	int ret = claimInode(d, tree, FILETYPE_DIRTREE);
+	if (ret == 0)
+		ret = growDirectory(d, tree, size);
+	if (ret == 0)
+		ret = transferDirBytes(tree, 0, image, size, 1);
+	free(image);
+	if (ret == -1)
+	{
+		releaseInode(d, tree);
+		free(tree);
+		return -1;
+	}
+	free(tree);
+
+	unsigned int oldIndex = header->indexInode;
+	header->indexInode = inodeNumber;
+	header->indexUsed = 0;
+	if (oldIndex != 0)
+	{
+		Inode *dirIndex = inodeLoad(oldIndex, d);
+		if (dirIndex == NULL || releaseInode(d, dirIndex) == -1)
+			ret = -1;
+		free(dirIndex);
+	}
+	return ret;
+}
+
+// Libera o indice de um diretorio que esta sendo liberado ou convertido.
+// Retorna 0 se bem sucedido ou -1 caso contrario
+int releaseDirIndex(Disk *d, Inode *inodeDir)
+{
+	DirHeader header;
+	if (inodeGetBlockAddr(inodeDir, 0) == 0 || readDirHeader(inodeDir, &header) == -1 || header.indexInode == 0)
+		return 0;
+	Inode *dirIndex = inodeLoad(header.indexInode, d);
+	if (dirIndex == NULL)
+		return -1;
+	int ret = releaseInode(d, dirIndex);
+	free(dirIndex);
+	return ret;
+}
+
+// Converte um diretorio de entradas de tamanho fixo para o formato
+// compacto. O indice antigo, que aponta para posicoes do formato anterior, e'
+// descartado e reconstruido se o diretorio for grande. O cabecalho e'
+// atualizado e gravado. Retorna 0 se bem sucedido ou -1 caso contrario
+int compactDirectory(Disk *d, Inode *inodeDir, DirHeader *header)
+{
+	Directory *dir = loadDirectory(d, inodeDir);
+	if (dir == NULL)
+		return -1;
+	// cada registro cabe em um trecho: no maximo um trecho por entrada
+	unsigned char *image = calloc(dir->numEntries + 1, DIR_CHUNK_SIZE);
+	if (image == NULL)
+	{
+		freeDirectory(dir);
+		return -1;
+	}
+	unsigned int chunkOffset = 0, pos = DIR_HEADER_SIZE, last = 0;
+	for (unsigned int i = 0; i < dir->numEntries; i++)
+	{
+		DirectoryEntry *entry = &dir->entries[i];
+		unsigned int length = dirRecordSize(entry->nameLength);
+		if (pos + length > DIR_CHUNK_SIZE)
+		{
+			setDirRecordLength(&image[chunkOffset], last, DIR_CHUNK_SIZE - last);
+			chunkOffset += DIR_CHUNK_SIZE;
+			pos = 0;
+		}
+		encodeDirRecord(&image[chunkOffset], pos, entry->inodeNumber, length, entry->name, entry->nameLength);
+		last = pos;
+		pos += length;
+	}
+	freeDirectory(dir);
+	if (pos == DIR_HEADER_SIZE)
+		encodeDirRecord(image, pos, 0, DIR_CHUNK_SIZE - pos, "", 0);
+	else
+		setDirRecordLength(&image[chunkOffset], last, DIR_CHUNK_SIZE - last);
+
+	int ret = releaseDirIndex(d, inodeDir);
+	header->format = DIR_FORMAT_COMPACT;
+	header->size = DIR_HEADER_SIZE;
+	header->indexInode = 0;
+	header->indexUsed = 0;
+	encodeDirHeader(header, image);
+	unsigned int size = inodeGetFileSize(inodeDir);
+	unsigned int newSize = chunkOffset + DIR_CHUNK_SIZE;
+	if (ret == 0)
+		ret = newSize > size ? growDirectory(d, inodeDir, newSize - size) : shrinkDirectory(inodeDir, newSize);
+	if (ret == 0)
+		ret = transferDirBytes(inodeDir, 0, image, newSize, 1);
+	free(image);
+	if (ret == 0 && header->numEntries >= DIR_INDEX_THRESHOLD && buildDirIndex(d, inodeDir, header) == 0)
+		ret = writeDirHeader(inodeDir, header);
+	return ret;
+}
+
+// Procura name nos registros de um diretorio compacto, trecho a trecho,
+// direto nos blocos em cache. Retorna 1 se encontrada, com sua posicao e seu
+// i-node em result, 0 se nao existir ou -1 em caso de falha
+int scanDirectory(Inode *inodeDir, const char *name, DirLookup *result)
+{
+	unsigned int nameLength = strlen(name);
+	unsigned int size = inodeGetFileSize(inodeDir);
+	for (unsigned int chunkOffset = 0; chunkOffset < size; chunkOffset += DIR_CHUNK_SIZE)
+	{
+		unsigned int blockAddr, inodeNumber, length, recordNameLength;
+		unsigned char *chunk = pinDirChunk(inodeDir, chunkOffset, &blockAddr);
+		if (chunk == NULL)
+			return -1;
+		for (unsigned int pos = dirChunkStart(chunkOffset); pos < DIR_CHUNK_SIZE; pos += length)
+		{
+			if (decodeDirRecord(chunk, pos, &inodeNumber, &length, &recordNameLength) == -1)
+			{
+				cacheUnpin(blockAddr, 0);
+				return -1;
+			}
+			if (inodeNumber != 0 && recordNameLength == nameLength &&
+				memcmp(&chunk[pos + DIR_RECORD_HEADER_SIZE], name, nameLength) == 0)
+			{
+				cacheUnpin(blockAddr, 0);
+				result->offset = chunkOffset + pos;
+				result->inodeNumber = inodeNumber;
+				return 1;
+			}
+		}
+		cacheUnpin(blockAddr, 0);
+	}
+	return 0;
+}
+
+// Procura a entrada name no diretorio, pelo indice se houver ou percorrendo
+// todas as entradas, preenchendo result. Retorna 1 se encontrada, 0 se nao
+// existir ou -1 em caso de falha
+int findDirectoryEntry(Disk *d, Inode *inodeDir, DirHeader *header, const char *name, DirLookup *result)
+{
+	if (header->indexInode != 0)
+	{
+		Inode *dirIndex = inodeLoad(header->indexInode, d);
+		if (dirIndex == NULL)
+			return -1;
+		int found;
+		if (inodeGetFileType(dirIndex) == FILETYPE_DIRTREE)
+			found = lookupDirTree(dirIndex, name, &result->inodeNumber, &result->offset);
+		else
+			found = probeDirIndex(inodeDir, header, dirIndex, name, &result->offset, &result->inodeNumber);
+		free(dirIndex);
+		return found;
+	}
+
+	if (header->format == DIR_FORMAT_COMPACT)
+		return scanDirectory(inodeDir, name, result);
+	Directory *dir = loadDirectory(d, inodeDir);
+	if (dir == NULL)
+		return -1;
+	int found = 0;
+	for (unsigned int i = 0; i < dir->numEntries && !found; i++)
+		if (strcmp(dir->entries[i].name, name) == 0)
+		{
+			result->offset = dir->entries[i].offset;
+			result->inodeNumber = dir->entries[i].inodeNumber;
+			found = 1;
+		}
+	freeDirectory(dir);
+	return found;
+}
+
+// Le o cabecalho de um diretorio que sera alterado, convertendo formatos
+// anteriores: entradas de tamanho fixo para o formato compacto e indice de
+// hash para a arvore de nomes, que e' carregada em *tree (NULL se o
+// diretorio nao tiver indice). Retorna 0 se bem sucedido ou -1 caso
+// contrario
+int openDirectoryForUpdate(Disk *d, Inode *inodeDir, DirHeader *header, Inode **tree)
+{
+	*tree = NULL;
+	if (readDirHeader(inodeDir, header) == -1)
+		return -1;
+	if (header->format == DIR_FORMAT_FIXED && compactDirectory(d, inodeDir, header) == -1)
+		return -1;
+	if (header->indexInode == 0)
+		return 0;
+	if ((*tree = inodeLoad(header->indexInode, d)) == NULL)
+		return -1;
+	if (inodeGetFileType(*tree) == FILETYPE_DIRTREE)
+		return 0;
+	free(*tree);
+	*tree = NULL;
+	if (buildDirIndex(d, inodeDir, header) == -1 || writeDirHeader(inodeDir, header) == -1)
+		return -1;
+	*tree = inodeLoad(header->indexInode, d);
+	return *tree != NULL ? 0 : -1;
+}
+
+// Descarta a arvore de nomes de um diretorio cujas entradas ela deixou de
+// refletir, apos uma falha ao altera-la. O diretorio segue sem indice, com o
+// cabecalho atualizado apenas em memoria, ate a arvore ser reconstruida
+void dropDirTree(Disk *d, DirHeader *header, Inode **tree)
+{
+	releaseInode(d, *tree);
+	free(*tree);
+	*tree = NULL;
+	header->indexInode = 0;
+}
+
+// Remove a entrada name de um diretorio. As demais entradas nao mudam de
+// posicao, e trechos vazios no fim do diretorio sao descartados. Retorna 0
+// se bem sucedido ou -1 caso contrario
+int removeDirectoryEntry(Disk *d, Inode *inodeDir, const char *name)
+{
+	DirHeader header;
+	DirLookup found;
+	Inode *tree;
+	if (openDirectoryForUpdate(d, inodeDir, &header, &tree) == -1)
+		return -1;
+	// o cache de nomes so volta a ter o nome depois da remocao completa
+	forgetDentry(inodeGetNumber(inodeDir), name);
+	int ret = tree != NULL ? lookupDirTree(tree, name, &found.inodeNumber, &found.offset)
+						   : scanDirectory(inodeDir, name, &found);
+	if (ret != 1 || removeDirRecord(inodeDir, found.offset) == -1)
+	{
+		free(tree);
+		return -1;
+	}
+	if (tree != NULL && removeDirTree(tree, name) == -1)
+		dropDirTree(d, &header, &tree);
+	free(tree);
+	// removido o registro, o cabecalho e' gravado mesmo se o diretorio nao
+	// puder ser reduzido
+	ret = 0;
+	unsigned int size = inodeGetFileSize(inodeDir);
+	while (size > DIR_CHUNK_SIZE && dirChunkIsEmpty(inodeDir, size - DIR_CHUNK_SIZE) == 1)
+		size -= DIR_CHUNK_SIZE;
+	if (size < inodeGetFileSize(inodeDir) && shrinkDirectory(inodeDir, size) == -1)
+		ret = -1;
+	header.numEntries--;
+	if (writeDirHeader(inodeDir, &header) == -1)
+		return -1;
+	storeDentry(inodeGetNumber(inodeDir), name, 0);
+	return ret;
+}
+
+// Insere a entrada name, para o i-node inodeNumber, em um diretorio
+// preparado por openDirectoryForUpdate, com a arvore de nomes em *tree se
+// houver. Um nome sabidamente ausente pelo cache de nomes dispensa a busca
+// no diretorio sem arvore. Uma falha ao inserir o nome na arvore nao desfaz
+// a entrada: a arvore e' descartada. O cabecalho e' atualizado apenas em
+// memoria. Retorna 0 se bem sucedido ou -1 se a entrada ja existir ou em
+// caso de falha
+int insertDirectoryEntry(Disk *d, Inode *inodeDir, DirHeader *header, Inode **tree, unsigned int inodeNumber,
+						 const char *name)
+{
+	unsigned int parent = inodeGetNumber(inodeDir);
+	Dentry *dentry = findDentry(parent, name);
+	if (dentry != NULL && dentry->inodeNumber != 0)
+		return -1;
+	int knownAbsent = dentry != NULL;
+	forgetDentry(parent, name);
+	DirLookup pos;
+	int found = 0;
+	if (*tree != NULL)
+		found = lookupDirTree(*tree, name, &pos.inodeNumber, &pos.offset);
+	else if (!knownAbsent)
+		found = scanDirectory(inodeDir, name, &pos);
+	if (found != 0)
+		return -1;
+
+	unsigned int entryOffset;
+	if (insertDirRecord(d, inodeDir, header, inodeNumber, name, &entryOffset) == -1)
+		return -1;
+	header->numEntries++;
+	if (*tree != NULL && insertDirTree(d, *tree, name, inodeNumber, entryOffset) == -1)
+		dropDirTree(d, header, tree);
+	storeDentry(parent, name, inodeNumber);
+	return 0;
+}
+
+// Acrescenta a entrada entryName, para o i-node inodeEntry, ao diretorio.
+// So o trecho que recebe o registro e o cabecalho sao alterados. Retorna 0
+// se bem sucedido ou -1 caso contrario
+int addDirectoryEntry(Disk *d, Inode *inodeDir, Inode *inodeEntry, const char *entryName)
+{
+	unsigned int nameLength = strlen(entryName);
+	if (nameLength == 0 || nameLength > MAX_FILENAME_LENGTH)
+		return -1;
+	Dentry *dentry = findDentry(inodeGetNumber(inodeDir), entryName);
+	if (dentry != NULL && dentry->inodeNumber != 0)
+		return -1;
+	DirHeader header;
+	Inode *tree;
+	if (openDirectoryForUpdate(d, inodeDir, &header, &tree) == -1)
+		return -1;
+	int ret = insertDirectoryEntry(d, inodeDir, &header, &tree, inodeGetNumber(inodeEntry), entryName);
+	free(tree);
+	if (ret == -1)
+		return -1;
+
+	// o i-node do diretorio so muda, e ja e' gravado, quando ele cresce; o
+	// cabecalho, que pode ter perdido a arvore, e' gravado de qualquer forma
+	inodeSetRefCount(inodeEntry, inodeGetRefCount(inodeEntry) + 1);
+	ret = inodeSave(inodeEntry);
+
+	// o diretorio ganha a arvore de nomes ao atingir o limite; uma falha
+	// nesse ponto nao desfaz a insercao, e o diretorio segue sem indice
+	if (ret == 0 && header.numEntries >= DIR_INDEX_THRESHOLD && header.indexInode == 0)
+		buildDirIndex(d, inodeDir, &header);
+	if (writeDirHeader(inodeDir, &header) == -1)
+		return -1;
+	return ret;
+}
+
+int createDirectory(Disk *d, Inode *inode)
+{
+	DirHeader header = {DIR_FORMAT_COMPACT, DIR_HEADER_SIZE, 0, 0, 0};
+	unsigned char buf[DIR_CHUNK_SIZE];
+	memset(buf, 0, DIR_CHUNK_SIZE);
+	encodeDirHeader(&header, buf);
+	encodeDirRecord(buf, DIR_HEADER_SIZE, 0, DIR_CHUNK_SIZE - DIR_HEADER_SIZE, "", 0);
+	unsigned int blocks[1];
+	if (allocateBlocks(d, 0, 1, blocks) == 0)
+	{
+		if (writeBlock(d, blocks[0], (char *)buf, DIR_CHUNK_SIZE) == 0)
+		{
+			inodeSetFileSize(inode, DIR_CHUNK_SIZE);
+			inodeSetGroupOwner(inode, 0);
+			inodeSetOwner(inode, 0);
+			inodeSetPermission(inode, 0);
+			if (claimInode(d, inode, FILETYPE_DIR) == -1 || setInodeBlock(inode, 0, 0, blocks[0]) == -1)
+				return -1;
+			setBlocksStatus(1, blocks, 1);
+			saveBitmap(d);
+			return addDirectoryEntry(d, inode, inode, ".");
+		}
+	}
+	return -1;
+}
+
+// funções open file
+FileDescriptor *createFileDescriptor(OpenInode *file)
+{
+	if (numFreeFds == 0 && numUsedFds >= MAX_OPEN_FILES)
+		return NULL;
+	FileDescriptor *openFile = malloc(sizeof(FileDescriptor));
+	if (openFile == NULL)
+		return NULL;
+	openFile->fd = numFreeFds > 0 ? freeFds[--numFreeFds] : ++numUsedFds;
+	openFile->file = file;
+	openFile->cursor = 0;
+	openFile->append = 0;
+	openFile->nextReadBlock = 0;
+	openFile->readaheadWindow = 0;
+	openFile->readaheadEnd = 0;
+	openFile->dirName = NULL;
+	openFiles[openFile->fd - 1] = openFile;
+	numOpenFiles++;
+	return openFile;
+}
+
+FileDescriptor *getFileDescriptor(unsigned int fd)
+{
+	if (fd == 0 || fd > numUsedFds)
+		return NULL;
+	return openFiles[fd - 1];
+}
+
+// Retira um descritor da tabela e devolve seu fd para reuso
+void removeFileDescriptor(FileDescriptor *openFile)
+{
+	openFiles[openFile->fd - 1] = NULL;
+	freeFds[numFreeFds++] = openFile->fd;
+	numOpenFiles--;
+}
+
+// Retorna o i-node aberto de numero number, carregando-o do disco se ainda nao
+// estiver em memoria, e acrescenta uma referencia a ele
+OpenInode *getOpenInode(Disk *d, unsigned int number)
+{
+	OpenInode **bucket = &openInodes[number % OPEN_INODE_HASH_SIZE];
+	OpenInode *file = *bucket;
+	while (file != NULL && inodeGetNumber(file->inode) != number)
+		file = file->hashNext;
+	if (file != NULL)
+	{
+		file->refs++;
+		return file;
+	}
+	file = malloc(sizeof(OpenInode));
+	if (file == NULL)
+		return NULL;
+	file->inode = inodeLoad(number, d);
+	if (file->inode == NULL)
+	{
+		free(file);
+		return NULL;
+	}
+	file->disk = d;
+	file->refs = 1;
+	// diretorios nao tem buracos: seus blocos saem do tamanho, sem percorrer
+	// a cadeia de extensoes, que em diretorios grandes e' longa, a cada uso
+	if (inodeGetFileType(file->inode) == FILETYPE_DIR)
+		file->numAllocatedBlocks = divideCeil(inodeGetFileSize(file->inode), superblock[SUPERBLOCK_ITEM_BLOCKSIZE]);
+	else
+		file->numAllocatedBlocks = inodeGetBlockCount(file->inode);
+	file->delayedStart = 0;
+	file->numDelayedBlocks = 0;
+	file->numReservedInodes = 0;
+	file->delayedData = NULL;
+	file->tailData = NULL;
+	file->hashNext = *bucket;
+	*bucket = file;
+	return file;
+}
+
+int flushDelayedBlocks(OpenInode *file);
+
+void unlinkTailLru(OpenInode *file)
+{
+	if (file->tailPrev != NULL)
+		file->tailPrev->tailNext = file->tailNext;
+	else
+		tailLruHead = file->tailNext;
+	if (file->tailNext != NULL)
+		file->tailNext->tailPrev = file->tailPrev;
+	else
+		tailLruTail = file->tailPrev;
+}
+
+void pushTailLru(OpenInode *file)
+{
+	file->tailPrev = NULL;
+	file->tailNext = tailLruHead;
+	if (tailLruHead != NULL)
+		tailLruHead->tailPrev = file;
+	else
+		tailLruTail = file;
+	tailLruHead = file;
+}
+
+// Libera o bloco final fixado por escritas em modo de acrescimo, marcando-o
+// como modificado no cache, e grava o i-node, cujo tamanho pode ter crescido
+// apenas em memoria. Com blocos postergados, o i-node so e' gravado no flush.
+// Retorna 0 caso bem sucedido, ou -1 caso contrario
+int releaseTailBlock(OpenInode *file)
+{
+	if (file->tailData == NULL)
+		return 0;
+	cacheUnpin(file->tailAddr, 1);
+	file->tailData = NULL;
+	unlinkTailLru(file);
+	numPinnedTails--;
+	if (file->numDelayedBlocks > 0)
+		return 0;
+	return inodeSave(file->inode);
+}
+
+// Mantem fixado no cache o bloco final parcialmente preenchido do arquivo,
+// ja com endereco fisico, para que os proximos acrescimos pequenos sejam
+// copiados direto para ele, sem percorrer o mapa de blocos nem gravar o
+// i-node a cada escrita. Blocos finais postergados ja ficam em memoria. Para
+// nao esgotar o cache com muitos arquivos abertos para acrescimo, o bloco
+// final fixado ha mais tempo sem uso e' liberado ao atingir o limite
+void holdTailBlock(OpenInode *file)
+{
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned long long fileSize = inodeGetFileSize(file->inode);
+	unsigned int tailBlock = fileSize / blockSize;
+	if (file->tailData != NULL && file->tailBlock == tailBlock)
+	{
+		if (file != tailLruHead)
+		{
+			unlinkTailLru(file);
+			pushTailLru(file);
+		}
+		return;
+	}
+	releaseTailBlock(file);
+	if (fileSize % blockSize == 0 || tailBlock >= file->numAllocatedBlocks)
+		return;
+	unsigned int maxPinnedTails = cacheGetNumEntries() / TAIL_PIN_FRACTION;
+	if (maxPinnedTails == 0)
+		return;
+	unsigned int tailAddr = inodeGetBlockAddr(file->inode, tailBlock);
+	if (tailAddr == 0)
+		return;
+	if (numPinnedTails >= maxPinnedTails)
+		releaseTailBlock(tailLruTail);
+	file->tailData = cachePin(tailAddr, 1);
+	if (file->tailData == NULL)
+		return;
+	file->tailBlock = tailBlock;
+	file->tailAddr = tailAddr;
+	pushTailLru(file);
+	numPinnedTails++;
+}
+
+// Retira o i-node aberto da tabela e libera sua copia em memoria, sem gravar
+// nada no disco
+void forgetOpenInode(OpenInode *file)
+{
+	OpenInode **link = &openInodes[inodeGetNumber(file->inode) % OPEN_INODE_HASH_SIZE];
+	while (*link != file)
+		link = &(*link)->hashNext;
+	*link = file->hashNext;
+	free(file->delayedData);
+	free(file->inode);
+	free(file);
+}
+
+int reserveDelayedInodes(OpenInode *file);
+
+// Retira uma referencia do i-node aberto. Na ultima, os blocos postergados sao
+// gravados, ou descartados junto com o i-node se nao houver mais entradas de
+// diretorio para ele, e a copia em memoria e' liberada. Se os blocos nao
+// puderem ser gravados, o i-node continua em memoria, sem referencias, com os
+// blocos e suas reservas, para nova tentativa em myFSSync ou em outra
+// abertura
+int putOpenInode(OpenInode *file)
+{
+	if (--file->refs > 0)
+		return 0;
+	int ret = releaseTailBlock(file);
+	if (inodeGetRefCount(file->inode) == 0)
+	{
+		reservedBlocks -= file->numDelayedBlocks;
+		file->numDelayedBlocks = 0;
+		reserveDelayedInodes(file);
+		if (releaseInode(file->disk, file->inode) == -1)
+			ret = -1;
+	}
+	else if (flushDelayedBlocks(file) == -1)
+		return -1;
+
+	forgetOpenInode(file);
+	return ret;
+}
+
+int loadRootInode(Disk *d)
+{
+	if (openRoot != NULL)
+		return 0;
+	openRoot = getOpenInode(d, ROOT_INODE_NUMBER);
+	if (openRoot == NULL)
+		return -1;
+	return 0;
+}
+
+// Retorna o bloco onde uma nova extensao do arquivo deveria comecar para
+// manter o arquivo contiguo em disco
+unsigned int extentGoal(OpenInode *file)
+{
+	if (file->numAllocatedBlocks == 0)
+		return 0;
+	return inodeGetBlockAddr(file->inode, file->numAllocatedBlocks - 1) + 1;
+}
+
+// Ajusta a reserva de i-nodes de um arquivo aberto aos necessarios para
+// enderecar seus blocos postergados: as extensoes alem das existentes.
+// Retorna -1, mantendo a reserva anterior, se nao houver i-nodes livres para
+// aumenta-la
+int reserveDelayedInodes(OpenInode *file)
+{
+	unsigned int needed = 0;
+	unsigned int delayedEnd = file->delayedStart + file->numDelayedBlocks;
+	if (file->numDelayedBlocks > 0 && delayedEnd > file->numAllocatedBlocks)
+		needed = numExtensionsForBlocks(delayedEnd) - numExtensionsForBlocks(file->numAllocatedBlocks);
+	if (needed > file->numReservedInodes)
+	{
+		unsigned int extra = needed - file->numReservedInodes;
+		if (superblock[SUPERBLOCK_ITEM_FREEINODES] < reservedInodes + extra)
+			reclaimSpace(file->disk, RECLAIM_ALL);
+		if (superblock[SUPERBLOCK_ITEM_FREEINODES] < reservedInodes + extra)
+			return -1;
+	}
+	reservedInodes = reservedInodes - file->numReservedInodes + needed;
+	file->numReservedInodes = needed;
+	return 0;
+}
+
+// Aloca fisicamente os blocos com alocacao postergada de um arquivo aberto.
+// Como o numero de blocos ja e' conhecido, tenta-se uma unica extensao
+// contigua; os enderecos sao registrados de uma vez, com cada i-node da
+// cadeia gravado uma unica vez, assim como o bitmap. As reservas do arquivo sao
+// consumidas pela alocacao. Em caso de falha, os blocos ainda nao gravados
+// continuam em memoria, com suas reservas. Retorna 0 se bem sucedido ou -1
+// caso contrario
+int flushDelayedBlocks(OpenInode *file)
+{
+	if (file->numDelayedBlocks == 0)
+		return 0;
+	unsigned int numBlocks = file->numDelayedBlocks;
+	unsigned int *blocks = malloc(numBlocks * sizeof(unsigned int));
+	if (blocks == NULL)
+		return -1;
+	reservedBlocks -= numBlocks;
+	reservedInodes -= file->numReservedInodes;
+	file->numReservedInodes = 0;
+	if (allocateBlocks(file->disk, extentGoal(file), numBlocks, blocks) == -1)
+	{
+		free(blocks);
+		reservedBlocks += numBlocks;
+		reserveDelayedInodes(file);
+		return -1;
+	}
+
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned int numWritten = 0;
+	for (; numWritten < numBlocks; numWritten++)
+		if (writeFullBlock(file->disk, blocks[numWritten], (char *)&file->delayedData[numWritten * blockSize]) == -1)
+			break;
+	// so os blocos gravados sao enderecados no i-node
+	if (numWritten > 0 && setInodeBlocks(file->inode, file->numAllocatedBlocks, file->delayedStart, numWritten, blocks) == -1)
+		numWritten = 0;
+	if (numWritten > 0 && file->delayedStart + numWritten > file->numAllocatedBlocks)
+		file->numAllocatedBlocks = file->delayedStart + numWritten;
+	setBlocksStatus(numWritten, blocks, 1);
+	free(blocks);
+	file->numDelayedBlocks = numBlocks - numWritten;
+	if (file->numDelayedBlocks == 0)
+	{
+		free(file->delayedData);
+		file->delayedData = NULL;
+	}
+	else
+	{
+		// os blocos restantes voltam a ser reservados; a reserva de i-nodes
+		// cabe, pois os i-nodes ja usados saem dela
+		memmove(file->delayedData, &file->delayedData[numWritten * blockSize], file->numDelayedBlocks * blockSize);
+		file->delayedStart += numWritten;
+		reservedBlocks += file->numDelayedBlocks;
+		reserveDelayedInodes(file);
+	}
+	if (saveBitmap(file->disk) == -1 || inodeSave(file->inode) == -1)
+		return -1;
+	return file->numDelayedBlocks == 0 ? 0 : -1;
+}
+
+// Acrescenta um bloco zerado ao buffer de alocacao postergada, reservando
+// espaco em disco e os i-nodes para enderecar o bloco. Retorna -1 se nao
+// houver espaco, i-nodes ou memoria
+int addDelayedBlock(OpenInode *file)
+{
+	if (reserveBlocks(file->disk, 1) == -1)
+		return -1;
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned char *data = realloc(file->delayedData, (file->numDelayedBlocks + 1) * blockSize);
+	if (data == NULL)
+	{
+		reservedBlocks--;
+		return -1;
+	}
+	memset(&data[file->numDelayedBlocks * blockSize], 0, blockSize);
+	file->delayedData = data;
+	file->numDelayedBlocks++;
+	// o bloco tambem precisa de i-nodes para ser enderecado no flush
+	if (reserveDelayedInodes(file) == -1)
+	{
+		file->numDelayedBlocks--;
+		reservedBlocks--;
+		return -1;
+	}
+	return 0;
+}
+
+// Aloca imediatamente um bloco para o buraco de indice blockNum de um arquivo
+// aberto, de preferencia logo apos o bloco anterior do arquivo. Retorna o
+// endereco do bloco ou 0 em caso de falha
+unsigned int allocateHoleBlock(OpenInode *file, unsigned int blockNum)
+{
+	unsigned int goal = 0;
+	if (blockNum > 0 && blockNum <= file->numAllocatedBlocks)
+		goal = inodeGetBlockAddr(file->inode, blockNum - 1);
+	if (goal != 0)
+		goal++;
+	unsigned int blocks[1];
+	if (allocateBlocks(file->disk, goal, 1, blocks) == -1)
+		return 0;
+	if (setInodeBlock(file->inode, file->numAllocatedBlocks, blockNum, blocks[0]) == -1)
+		return 0;
+	if (blockNum >= file->numAllocatedBlocks)
+		file->numAllocatedBlocks = blockNum + 1;
+	setBlocksStatus(1, blocks, 1);
+	if (saveBitmap(file->disk) == -1)
+		return 0;
+	return blocks[0];
+}
+
+// Zera os bytes [from, to) de um arquivo aberto nos blocos que possuem
+// conteudo, alocados ou com alocacao postergada; buracos ja sao lidos como
+// zeros. Necessario quando uma escrita comeca alem do fim do arquivo, pois
+// blocos alocados podem guardar dados antigos apos o tamanho do arquivo
+int zeroFileRange(OpenInode *file, unsigned long long from, unsigned long long to)
+{
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned int delayedEnd = file->delayedStart + file->numDelayedBlocks;
+	unsigned int firstBlock = from / blockSize;
+	unsigned int lastBlock = divideCeil(to, blockSize);
+	unsigned int contentEnd = delayedEnd > file->numAllocatedBlocks ? delayedEnd : file->numAllocatedBlocks;
+	if (lastBlock > contentEnd)
+		lastBlock = contentEnd;
+	if (firstBlock >= lastBlock)
+		return 0;
+	unsigned int mappedEnd = lastBlock < file->numAllocatedBlocks ? lastBlock : file->numAllocatedBlocks;
+	unsigned int numMapped = 0;
+	unsigned int *blockAddrs = NULL;
+	if (firstBlock < mappedEnd)
+	{
+		blockAddrs = malloc((mappedEnd - firstBlock) * sizeof(unsigned int));
+		if (blockAddrs == NULL)
+			return -1;
+		numMapped = inodeGetBlockAddrs(file->inode, firstBlock, mappedEnd - firstBlock, blockAddrs);
+	}
+
+	int ret = 0;
+	for (unsigned int block = firstBlock; block < lastBlock; block++)
+	{
+		unsigned long long blockStart = (unsigned long long)block * blockSize;
+		unsigned int begin = from > blockStart ? from - blockStart : 0;
+		unsigned int end = to < blockStart + blockSize ? to - blockStart : blockSize;
+		if (file->numDelayedBlocks > 0 && block >= file->delayedStart && block < delayedEnd)
+			memset(&file->delayedData[(block - file->delayedStart) * blockSize + begin], 0, end - begin);
+		else if (block < firstBlock + numMapped && blockAddrs[block - firstBlock] != 0)
+		{
+			unsigned int blockAddr = blockAddrs[block - firstBlock];
+			unsigned char *blockData = cachePin(blockAddr, begin != 0 || end != blockSize);
+			if (blockData == NULL)
+			{
+				ret = -1;
+				break;
+			}
+			memset(&blockData[begin], 0, end - begin);
+			cacheUnpin(blockAddr, 1);
+		}
+	}
+	free(blockAddrs);
+	return ret;
+}
+
+// Carrega no cache os blocos [firstBlock, lastBlock) de um arquivo aberto e,
+// se o acesso for sequencial, os blocos seguintes da janela de leitura
+// antecipada. Blocos fisicamente contiguos sao lidos em sequencia, sem
+// reposicionamento da cabeca do disco entre eles
+void readaheadBlocks(FileDescriptor *openFile, unsigned int firstBlock, unsigned int lastBlock)
+{
+	if (firstBlock == openFile->nextReadBlock)
+	{
+		openFile->readaheadWindow *= 2;
+		if (openFile->readaheadWindow < READAHEAD_MIN_BLOCKS)
+			openFile->readaheadWindow = READAHEAD_MIN_BLOCKS;
+		if (openFile->readaheadWindow > READAHEAD_MAX_BLOCKS)
+			openFile->readaheadWindow = READAHEAD_MAX_BLOCKS;
+	}
+	else
+	{
+		openFile->readaheadWindow = 0;
+		openFile->readaheadEnd = firstBlock;
+	}
+	openFile->nextReadBlock = lastBlock;
+
+	unsigned int from = firstBlock > openFile->readaheadEnd ? firstBlock : openFile->readaheadEnd;
+	unsigned int to = lastBlock + openFile->readaheadWindow;
+	if (to > openFile->file->numAllocatedBlocks)
+		to = openFile->file->numAllocatedBlocks;
+	if (from >= to)
+		return;
+	unsigned int *addrs = malloc((to - from) * sizeof(unsigned int));
+	if (addrs == NULL)
+		return;
+	unsigned int numAddrs = inodeGetBlockAddrs(openFile->file->inode, from, to - from, addrs);
+	unsigned int runStart = 0;
+	for (unsigned int i = 1; i <= numAddrs; i++)
+	{
+		if (i < numAddrs && addrs[i] != 0 && addrs[i] == addrs[i - 1] + 1)
+			continue;
+		if (addrs[runStart] != 0)
+			cacheReadahead(addrs[runStart], i - runStart);
+		runStart = i;
+	}
+	free(addrs);
+	openFile->readaheadEnd = to;
+}
+
+int loadFSData(Disk *d)
+{
+	if (d == NULL)
+		return -1;
+	if (loadSuperblock(d) == -1)
+		return -1;
+	if (cacheGetDisk() != d)
+	{
+		// nomes guardados de outra montagem podem nao valer mais
+		forgetDentries(0);
+		forgetDirTreeMap(0);
+		if (cacheInit(d, superblock[SUPERBLOCK_ITEM_BLOCKSIZE], CACHE_MEMORY_BUDGET) == -1)
+			return -1;
+	}
+	if (loadBitmap(d) == -1)
+		return -1;
+	// os contadores de espaco livre so existem em discos com a assinatura de
+	// SUPERBLOCK_ITEM_LAYOUT; nos antigos, esses itens sao lixo e os
+	// contadores sao recalculados a cada montagem
+	if (superblock[SUPERBLOCK_ITEM_LAYOUT] != SUPERBLOCK_LAYOUT_64BIT ||
+		superblock[SUPERBLOCK_ITEM_FREEBLOCKS] > superblock[SUPERBLOCK_ITEM_NUMBLOCKS] ||
+		superblock[SUPERBLOCK_ITEM_FREEINODES] > superblock[SUPERBLOCK_ITEM_NUMINODES])
+		if (recountFreeSpace(d) == -1)
+			return -1;
+	if (loadRootInode(d) == -1)
+		return -1;
+	return 0;
+}
+
+// Funcao para verificacao se o sistema de arquivos está ocioso, ou seja,
+// se nao ha quisquer descritores de arquivos em uso atualmente. Retorna
+// um positivo se ocioso ou, caso contrario, 0.
+int myFSIsIdle(Disk *d)
+{
+	if (numOpenFiles > 0 || mappings != NULL)
+		return 0;
+	return 1;
+}
+
+// Funcao para formatacao de um disco com o novo sistema de arquivos
+// com tamanho de blocos igual a blockSize. Retorna o numero total de
+// blocos disponiveis no disco, se formatado com sucesso. Caso contrario,
+// retorna -1.
+int myFSFormat(Disk *d, unsigned int blockSize)
+{
+	// Verificação de parâmetros inválidos
+	if (d == NULL || blockSize == 0)
+		return -1;
+
+	// criar superbloco
+	if (blockSize % DISK_SECTORDATASIZE != 0 || diskGetSize(d) / blockSize > UINT_MAX)
+		return -1;
+	free(superblock);
+	free(bitmap);
+	superblock = malloc(SUPERBLOCK_SIZE * sizeof(unsigned int));
+	if (superblock == NULL)
+		return -1;
+	superblock[SUPERBLOCK_ITEM_BLOCKSIZE] = blockSize;
+	superblock[SUPERBLOCK_ITEM_NUMBLOCKS] = diskGetSize(d) / blockSize;
+	superblock[SUPERBLOCK_ITEM_NUMINODES] = superblock[SUPERBLOCK_ITEM_NUMBLOCKS] / NUMBLOCKS_PERINODE;
+	superblock[SUPERBLOCK_ITEM_LAYOUT] = SUPERBLOCK_LAYOUT_64BIT;
+	inodeSetAreaNumInodes(superblock[SUPERBLOCK_ITEM_NUMINODES]);
+	inodeSetLayout(INODE_LAYOUT_64BIT_SIZE);
+	if (cacheInit(d, blockSize, CACHE_MEMORY_BUDGET) == -1)
+		return -1;
+
+	// a copia da raiz e os nomes de uma formatacao anterior deixam de valer
+	if (openRoot != NULL)
+	{
+		forgetOpenInode(openRoot);
+		openRoot = NULL;
+	}
+	forgetDentries(0);
+	forgetDirTreeMap(0);
+
+	// Inicializar i-nodes
+	for (int i = 1; i < superblock[SUPERBLOCK_ITEM_NUMINODES] + 1; i++)
+	{
+		Inode *inode = inodeCreate(i, d);
+		if (inode == NULL)
+			return -1;
+		free(inode);
+	}
+
+	// criar bitmap
+	// uma entrada por bloco, em quantos blocos forem necessarios, logo apos
+	// a area de i-nodes
+	bitmap = calloc(superblock[SUPERBLOCK_ITEM_NUMBLOCKS], sizeof(unsigned char));
+	if (bitmap == NULL)
+		return -1;
+	unsigned int inodesSectors = divideCeil(superblock[SUPERBLOCK_ITEM_NUMINODES], inodeNumInodesPerSector());
+	unsigned int inodesBlocks = divideCeil(inodesSectors + inodeAreaBeginSector(), blockSize / DISK_SECTORDATASIZE);
+	unsigned int bitmapBlocks = divideCeil(superblock[SUPERBLOCK_ITEM_NUMBLOCKS], blockSize);
+	if (inodesBlocks + bitmapBlocks >= superblock[SUPERBLOCK_ITEM_NUMBLOCKS])
+		return -1;
+	for (unsigned int i = 0; i < inodesBlocks + bitmapBlocks; i++)
+		bitmap[i] = 1;
+	markBitmapDirty(0, superblock[SUPERBLOCK_ITEM_NUMBLOCKS]);
+	superblock[SUPERBLOCK_ITEM_BITMAPBLOCK] = inodesBlocks;
+	superblock[SUPERBLOCK_ITEM_FREEBLOCKS] = superblock[SUPERBLOCK_ITEM_NUMBLOCKS] - (inodesBlocks + bitmapBlocks);
+	superblock[SUPERBLOCK_ITEM_FREEINODES] = superblock[SUPERBLOCK_ITEM_NUMINODES];
+	if (saveSuperblock(d) == -1)
+		return -1;
+	if (saveBitmap(d) == -1)
+		return -1;
+
+	// create root
+	if (loadRootInode(d) == -1)
+		return -1;
+	if (createDirectory(d, openRoot->inode) == -1)
+		return -1;
+	if (addDirectoryEntry(d, openRoot->inode, openRoot->inode, "..") == -1)
+		return -1;
+	if (cacheSync() == -1)
+		return -1;
+	return superblock[SUPERBLOCK_ITEM_NUMBLOCKS];
+}
+
+int splitPath(const char *path, char ***entries)
+{
+	if (path == NULL || path[0] == '\0')
+	{
+		*entries = NULL;
+		return 0;
 	}
 
 	char **result = malloc(MAX_PATH_LENGTH * sizeof(char *));
@@ -525,6 +2784,12 @@ int splitPath(const char *path, char ***entries)
 		token = strtok(NULL, "/");
 	}
 	free(pathCopy);
+	if (count == 0)
+	{
+		free(result);
+		*entries = NULL;
+		return 0;
+	}
 	result = (char **)realloc(result, count * sizeof(char *));
 	if (result == NULL)
 		return -1;
@@ -532,257 +2797,1232 @@ int splitPath(const char *path, char ***entries)
 	return count;
 }
 
-// Funcao para abertura de um arquivo, a partir do caminho especificado
-// em path, no disco montado especificado em d, no modo Read/Write,
-// criando o arquivo se nao existir. Retorna um descritor de arquivo,
-// em caso de sucesso. Retorna -1, caso contrario.
-int myFSOpen(Disk *d, const char *path)
+// Procura a entrada name no diretorio inodeDir, primeiro no cache de nomes.
+// Retorna o numero do i-node da entrada ou 0 se nao existir
+unsigned int lookupEntry(Disk *d, Inode *inodeDir, const char *name)
+{
+	unsigned int parent = inodeGetNumber(inodeDir);
+	Dentry *dentry = findDentry(parent, name);
+	if (dentry != NULL)
+		return dentry->inodeNumber;
+	DirHeader header;
+	DirLookup found;
+	if (readDirHeader(inodeDir, &header) == -1)
+		return 0;
+	// falhas de leitura nao sao guardadas como entradas negativas
+	int ret = findDirectoryEntry(d, inodeDir, &header, name, &found);
+	if (ret == -1)
+		return 0;
+	storeDentry(parent, name, ret == 1 ? found.inodeNumber : 0);
+	return ret == 1 ? found.inodeNumber : 0;
+}
+
+// Percorre path a partir da raiz ate o diretorio que contem o ultimo
+// componente, cujo nome e' copiado para name (string vazia se path for a
+// propria raiz). Retorna o diretorio aberto, com uma referencia a ser
+// devolvida com putOpenInode, ou NULL se algum componente intermediario nao
+// existir ou nao for um diretorio
+OpenInode *walkPath(Disk *d, const char *path, char *name)
+{
+	char **entries = NULL;
+	int numEntries = splitPath(path, &entries);
+	if (numEntries == -1)
+		return NULL;
+
+	OpenInode *dirFile = openRoot;
+	dirFile->refs++;
+	for (int i = 0; dirFile != NULL && i < numEntries - 1; i++)
+	{
+		unsigned int inodeNumber = lookupEntry(d, dirFile->inode, entries[i]);
+		putOpenInode(dirFile);
+		dirFile = inodeNumber != 0 ? getOpenInode(d, inodeNumber) : NULL;
+		if (dirFile != NULL && inodeGetFileType(dirFile->inode) != FILETYPE_DIR)
+		{
+			putOpenInode(dirFile);
+			dirFile = NULL;
+		}
+	}
+	name[0] = '\0';
+	if (dirFile != NULL && numEntries > 0)
+	{
+		// o nome e' gravado com MAX_FILENAME_LENGTH bytes, incluindo o \0
+		if (strlen(entries[numEntries - 1]) >= MAX_FILENAME_LENGTH)
+		{
+			putOpenInode(dirFile);
+			dirFile = NULL;
+		}
+		else
+			strcpy(name, entries[numEntries - 1]);
+	}
+
+	for (int i = 0; i < numEntries; i++)
+		free(entries[i]);
+	free(entries);
+	return dirFile;
+}
+
+// Funcao para abertura de um arquivo, a partir do caminho especificado
+// em path, no disco montado especificado em d, no modo Read/Write,
+// criando o arquivo se nao existir. Retorna um descritor de arquivo,
+// em caso de sucesso. Retorna -1, caso contrario.
+int myFSOpen(Disk *d, const char *path)
+{
+	if (loadFSData(d) == -1)
+		return -1;
+	char name[MAX_FILENAME_LENGTH];
+	OpenInode *dirFile = walkPath(d, path, name);
+	if (dirFile == NULL)
+		return -1;
+
+	OpenInode *file = NULL;
+	unsigned int inodeNumber = name[0] != '\0' ? lookupEntry(d, dirFile->inode, name) : 0;
+	if (inodeNumber != 0)
+	{
+		file = getOpenInode(d, inodeNumber);
+		// diretorios so sao abertos por myFSOpenDir
+		if (file != NULL && inodeGetFileType(file->inode) != FILETYPE_REGULAR)
+		{
+			putOpenInode(file);
+			file = NULL;
+		}
+	}
+	else if (name[0] != '\0')
+	{
+		inodeNumber = findFreeInode(d);
+		if (inodeNumber != 0)
+		{
+			file = getOpenInode(d, inodeNumber);
+			if (file != NULL)
+			{
+				// o arquivo nasce sem blocos; o primeiro e' alocado no flush,
+				// junto com o restante da extensao
+				inodeSetFileSize(file->inode, 0);
+				inodeSetGroupOwner(file->inode, 0);
+				inodeSetOwner(file->inode, 0);
+				inodeSetPermission(file->inode, 0);
+				// sem entrada de diretorio, o i-node e' liberado ao soltar a referencia
+				if (claimInode(d, file->inode, FILETYPE_REGULAR) == -1 ||
+					addDirectoryEntry(d, dirFile->inode, file->inode, name) == -1)
+				{
+					putOpenInode(file);
+					file = NULL;
+				}
+			}
+		}
+	}
+
+	unsigned int fd = 0;
+	if (file != NULL)
+	{
+		FileDescriptor *newFileDescriptor = createFileDescriptor(file);
+		if (newFileDescriptor != NULL)
+			fd = newFileDescriptor->fd;
+		else
+			putOpenInode(file);
+	}
+	putOpenInode(dirFile);
+
+	return fd != 0 ? (int)fd : -1;
+}
+
+// Le ate nbytes de um arquivo aberto a partir de offset, sem alterar o
+// cursor. Retorna o numero de bytes lidos ou -1 em caso de falha
+int readFileAt(FileDescriptor *openFile, char *buf, unsigned int nbytes, unsigned long long offset)
+{
+	if (inodeGetFileType(openFile->file->inode) != FILETYPE_REGULAR)
+		return -1;
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned long long fileSize = inodeGetFileSize(openFile->file->inode);
+	if (offset >= fileSize || nbytes == 0)
+		return 0;
+	if (nbytes > INT_MAX)
+		nbytes = INT_MAX;
+	unsigned int sizeToRead = nbytes > fileSize - offset ? fileSize - offset : nbytes;
+	unsigned int firstBlock = offset / blockSize;
+	unsigned int lastBlock = divideCeil(offset + sizeToRead, blockSize);
+	readaheadBlocks(openFile, firstBlock, lastBlock);
+
+	unsigned int mappedEnd = lastBlock < openFile->file->numAllocatedBlocks ? lastBlock : openFile->file->numAllocatedBlocks;
+	unsigned int numMapped = 0;
+	unsigned int *blockAddrs = NULL;
+	if (firstBlock < mappedEnd)
+	{
+		blockAddrs = malloc((mappedEnd - firstBlock) * sizeof(unsigned int));
+		if (blockAddrs == NULL)
+			return -1;
+		numMapped = inodeGetBlockAddrs(openFile->file->inode, firstBlock, mappedEnd - firstBlock, blockAddrs);
+	}
+
+	unsigned int bytesRead = 0;
+	while (bytesRead < sizeToRead)
+	{
+		unsigned int block = (offset + bytesRead) / blockSize;
+		unsigned int blockOffset = (offset + bytesRead) % blockSize;
+		unsigned int sizeInBlock = blockSize - blockOffset;
+		if (sizeInBlock > sizeToRead - bytesRead)
+			sizeInBlock = sizeToRead - bytesRead;
+
+		if (openFile->file->numDelayedBlocks > 0 && block >= openFile->file->delayedStart &&
+			block < openFile->file->delayedStart + openFile->file->numDelayedBlocks)
+			memcpy(&buf[bytesRead], &openFile->file->delayedData[(block - openFile->file->delayedStart) * blockSize + blockOffset], sizeInBlock);
+		else if (block < openFile->file->numAllocatedBlocks && block >= firstBlock + numMapped)
+			break;
+		else if (block >= openFile->file->numAllocatedBlocks || blockAddrs[block - firstBlock] == 0)
+			// buracos sao lidos como zeros, sem acesso ao disco
+			memset(&buf[bytesRead], 0, sizeInBlock);
+		else if (sizeInBlock == blockSize)
+		{
+			if (readBlock(openFile->file->disk, blockAddrs[block - firstBlock], &buf[bytesRead]) == -1)
+				break;
+		}
+		else
+		{
+			unsigned int blockAddr = blockAddrs[block - firstBlock];
+			unsigned char *blockData = cachePin(blockAddr, 1);
+			if (blockData == NULL)
+				break;
+			memcpy(&buf[bytesRead], &blockData[blockOffset], sizeInBlock);
+			cacheUnpin(blockAddr, 0);
+		}
+		bytesRead += sizeInBlock;
+	}
+	free(blockAddrs);
+	if (bytesRead != sizeToRead)
+		return -1;
+	return bytesRead;
+}
+
+// Copia os bytes escritos no arquivo para as paginas ja carregadas dos
+// mapeamentos do mesmo arquivo, mantendo-os coerentes com read/write. O
+// mapeamento de onde os dados vieram (msync) nao e' alterado
+void updateMappedPages(OpenInode *file, const char *buf, unsigned int nbytes, unsigned long long offset)
+{
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	for (Mapping *map = mappings; map != NULL; map = map->next)
+	{
+		unsigned long long mapEnd = map->offset + (unsigned long long)map->numPages * blockSize;
+		if (map->view.file != file || offset + nbytes <= map->offset || offset >= mapEnd)
+			continue;
+		if (buf >= map->data && buf < map->data + map->numPages * blockSize)
+			continue;
+		unsigned long long from = offset > map->offset ? offset : map->offset;
+		unsigned long long to = offset + nbytes < mapEnd ? offset + nbytes : mapEnd;
+		for (unsigned long long pos = from; pos < to;)
+		{
+			unsigned int page = (pos - map->offset) / blockSize;
+			unsigned long long pageEnd = map->offset + (unsigned long long)(page + 1) * blockSize;
+			unsigned int size = (to < pageEnd ? to : pageEnd) - pos;
+			if (map->pageState[page] != MAP_PAGE_ABSENT)
+				memcpy(&map->data[pos - map->offset], &buf[pos - offset], size);
+			pos += size;
+		}
+	}
+}
+
+// Escreve nbytes de buf em um arquivo aberto a partir de offset, sem alterar
+// o cursor. Retorna o numero de bytes escritos ou -1 em caso de falha
+int writeFileAt(OpenInode *file, const char *buf, unsigned int nbytes, unsigned long long offset)
+{
+	if (inodeGetFileType(file->inode) != FILETYPE_REGULAR)
+		return -1;
+	// escritas alem do maior tamanho de arquivo sao truncadas no limite
+	if (offset >= maxFileSize() && nbytes > 0)
+		return -1;
+	if (nbytes > INT_MAX)
+		nbytes = INT_MAX;
+	if (nbytes > maxFileSize() - offset)
+		nbytes = maxFileSize() - offset;
+	unsigned long long fileSize = inodeGetFileSize(file->inode);
+	unsigned int tailOffset = offset % superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	if (file->tailData != NULL && offset == fileSize && nbytes > 0 &&
+		offset / superblock[SUPERBLOCK_ITEM_BLOCKSIZE] == file->tailBlock &&
+		tailOffset + nbytes <= superblock[SUPERBLOCK_ITEM_BLOCKSIZE])
+	{
+		// acrescimo que cabe no bloco final fixado; o bloco e' devolvido ao
+		// cache quando fica cheio
+		memcpy(&file->tailData[tailOffset], buf, nbytes);
+		inodeSetFileSize(file->inode, offset + nbytes);
+		updateMappedPages(file, buf, nbytes, offset);
+		if (tailOffset + nbytes == superblock[SUPERBLOCK_ITEM_BLOCKSIZE] && releaseTailBlock(file) == -1)
+			return -1;
+		return nbytes;
+	}
+	// o intervalo entre o fim do arquivo e offset vira um buraco, sem blocos
+	// novos; apenas blocos ja existentes nesse intervalo sao zerados
+	if (offset > fileSize && nbytes > 0 && zeroFileRange(file, fileSize, offset) == -1)
+		return -1;
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned int firstBlock = offset / blockSize;
+	unsigned int lastBlock = divideCeil(offset + nbytes, blockSize);
+	if (lastBlock > file->numAllocatedBlocks)
+		lastBlock = file->numAllocatedBlocks;
+	unsigned int numMapped = 0;
+	unsigned int *blockAddrs = NULL;
+	if (firstBlock < lastBlock)
+	{
+		blockAddrs = malloc((lastBlock - firstBlock) * sizeof(unsigned int));
+		if (blockAddrs == NULL)
+			return -1;
+		numMapped = inodeGetBlockAddrs(file->inode, firstBlock, lastBlock - firstBlock, blockAddrs);
+	}
+
+	unsigned int bufferOffset = 0;
+	while (bufferOffset < nbytes)
+	{
+		unsigned int cursorBlock = (offset + bufferOffset) / blockSize;
+		unsigned int cursorBlockOffset = (offset + bufferOffset) % blockSize;
+		unsigned int sizeToWrite = blockSize - cursorBlockOffset;
+		if (sizeToWrite > nbytes - bufferOffset)
+			sizeToWrite = nbytes - bufferOffset;
+
+		unsigned int blockAddr = 0;
+		if (cursorBlock < firstBlock + numMapped)
+			blockAddr = blockAddrs[cursorBlock - firstBlock];
+		else if (cursorBlock < file->numAllocatedBlocks)
+			blockAddr = inodeGetBlockAddr(file->inode, cursorBlock);
+		unsigned int delayedEnd = file->delayedStart + file->numDelayedBlocks;
+
+		if (blockAddr != 0)
+		{
+			if (sizeToWrite == blockSize)
+			{
+				// bloco inteiro sobrescrito: nada a ler, grava direto de buf
+				if (writeFullBlock(file->disk, blockAddr, &buf[bufferOffset]) == -1)
+					break;
+			}
+			else
+			{
+				// bloco parcial e' alterado diretamente no cache
+				unsigned char *blockData = cachePin(blockAddr, 1);
+				if (blockData == NULL)
+					break;
+				memcpy(&blockData[cursorBlockOffset], &buf[bufferOffset], sizeToWrite);
+				cacheUnpin(blockAddr, 1);
+			}
+		}
+		else if (file->numDelayedBlocks > 0 && cursorBlock >= file->delayedStart && cursorBlock < delayedEnd)
+			memcpy(&file->delayedData[(cursorBlock - file->delayedStart) * blockSize + cursorBlockOffset], &buf[bufferOffset], sizeToWrite);
+		else if (cursorBlock < file->numAllocatedBlocks)
+		{
+			// buraco no meio do arquivo: o bloco e' alocado na hora
+			blockAddr = allocateHoleBlock(file, cursorBlock);
+			if (blockAddr == 0)
+				break;
+			if (sizeToWrite == blockSize)
+			{
+				if (writeFullBlock(file->disk, blockAddr, &buf[bufferOffset]) == -1)
+					break;
+			}
+			else
+			{
+				unsigned char *blockData = cachePin(blockAddr, 0);
+				if (blockData == NULL)
+					break;
+				memset(blockData, 0, blockSize);
+				memcpy(&blockData[cursorBlockOffset], &buf[bufferOffset], sizeToWrite);
+				cacheUnpin(blockAddr, 1);
+			}
+		}
+		else if (file->numDelayedBlocks > 0 && (cursorBlock != delayedEnd || file->numDelayedBlocks == MAX_DELAYED_BLOCKS))
+		{
+			// o buffer postergado so cresce de forma contigua: fora dele,
+			// ou com ele cheio, os blocos pendentes sao alocados antes
+			if (flushDelayedBlocks(file) == -1)
+				break;
+			continue;
+		}
+		else
+		{
+			// blocos alem dos alocados sao apenas reservados; o endereco
+			// fisico e' escolhido no flush, quando o tamanho final e' conhecido
+			if (file->numDelayedBlocks == 0)
+				file->delayedStart = cursorBlock;
+			if (addDelayedBlock(file) == -1)
+				break;
+			memcpy(&file->delayedData[(cursorBlock - file->delayedStart) * blockSize + cursorBlockOffset], &buf[bufferOffset], sizeToWrite);
+		}
+		bufferOffset += sizeToWrite;
+	}
+	free(blockAddrs);
+	updateMappedPages(file, buf, bufferOffset, offset);
+
+	if (offset + bufferOffset > inodeGetFileSize(file->inode))
+	{
+		inodeSetFileSize(file->inode, offset + bufferOffset);
+		// com blocos pendentes o inode so e' gravado no flush
+		if (file->numDelayedBlocks == 0 && inodeSave(file->inode) == -1)
+			return -1;
+	}
+	if (bufferOffset == 0 && nbytes > 0)
+		return -1;
+	return bufferOffset;
+}
+
+// Funcao para a leitura de um arquivo, a partir de um descritor de
+// arquivo existente. Os dados lidos sao copiados para buf e terao
+// tamanho maximo de nbytes. Retorna o numero de bytes efetivamente
+// lidos em caso de sucesso ou -1, caso contrario.
+int myFSRead(int fd, char *buf, unsigned int nbytes)
+{
+	FileDescriptor *openFile = getFileDescriptor(fd);
+	if (openFile == NULL || loadFSData(openFile->file->disk) == -1)
+		return -1;
+	int bytesRead = readFileAt(openFile, buf, nbytes, openFile->cursor);
+	if (bytesRead > 0)
+		openFile->cursor += bytesRead;
+	return bytesRead;
+}
+
+// Escreve nbytes de buf na posicao do cursor, ou no fim do arquivo em modo
+// de acrescimo, e avanca o cursor. Retorna o numero de bytes escritos ou -1
+// em caso de falha
+int writeAtCursor(FileDescriptor *openFile, const char *buf, unsigned int nbytes)
+{
+	if (openFile->append)
+		openFile->cursor = inodeGetFileSize(openFile->file->inode);
+	int bytesWritten = writeFileAt(openFile->file, buf, nbytes, openFile->cursor);
+	if (bytesWritten > 0)
+	{
+		openFile->cursor += bytesWritten;
+		if (openFile->append)
+			holdTailBlock(openFile->file);
+	}
+	return bytesWritten;
+}
+
+// Funcao para a escrita de um arquivo, a partir de um descritor de
+// arquivo existente. Os dados de buf serao copiados para o disco e
+// terao tamanho maximo de nbytes. Retorna o numero de bytes
+// efetivamente escritos em caso de sucesso ou -1, caso contrario
+int myFSWrite(int fd, const char *buf, unsigned int nbytes)
+{
+	FileDescriptor *openFile = getFileDescriptor(fd);
+	if (openFile == NULL || loadFSData(openFile->file->disk) == -1)
+		return -1;
+	return writeAtCursor(openFile, buf, nbytes);
+}
+
+// Funcao para ligar (append diferente de 0) ou desligar o modo de acrescimo
+// de um arquivo aberto. Nesse modo, myFSWrite e myFSWritev sempre escrevem
+// no fim do arquivo, e o bloco final parcialmente preenchido fica fixado em
+// memoria, acumulando acrescimos pequenos ate encher ou ate o flush ou
+// fechamento. Retorna 0 caso bem sucedido, ou -1 caso contrario
+int myFSSetAppend(int fd, int append)
+{
+	FileDescriptor *openFile = getFileDescriptor(fd);
+	if (openFile == NULL || loadFSData(openFile->file->disk) == -1)
+		return -1;
+	if (inodeGetFileType(openFile->file->inode) != FILETYPE_REGULAR)
+		return -1;
+	openFile->append = append != 0;
+	if (!openFile->append)
+		return releaseTailBlock(openFile->file);
+	return 0;
+}
+
+// Soma os tamanhos dos trechos de iov. Retorna o total ou -1 se iov for
+// invalido ou o total nao couber em um int
+int iovecTotalLength(const FSIOVec *iov, unsigned int iovcnt)
+{
+	if (iov == NULL && iovcnt > 0)
+		return -1;
+	unsigned int total = 0;
+	for (unsigned int i = 0; i < iovcnt; i++)
+	{
+		if (iov[i].len > 0 && iov[i].base == NULL)
+			return -1;
+		if (iov[i].len > INT_MAX - total)
+			return -1;
+		total += iov[i].len;
+	}
+	return total;
+}
+
+// Funcao para a leitura vetorizada de um arquivo, a partir de um descritor
+// de arquivo existente. Os trechos sao atendidos por uma unica leitura, com
+// um so mapeamento de blocos, e distribuidos em seguida. Retorna o numero de
+// bytes efetivamente lidos em caso de sucesso ou -1, caso contrario
+int myFSReadv(int fd, const FSIOVec *iov, unsigned int iovcnt)
+{
+	FileDescriptor *openFile = getFileDescriptor(fd);
+	int total = iovecTotalLength(iov, iovcnt);
+	if (openFile == NULL || total == -1 || loadFSData(openFile->file->disk) == -1)
+		return -1;
+	if (iovcnt == 1)
+		return myFSRead(fd, iov[0].base, iov[0].len);
+	char *buf = malloc(total > 0 ? total : 1);
+	if (buf == NULL)
+		return -1;
+	int bytesRead = readFileAt(openFile, buf, total, openFile->cursor);
+	unsigned int copied = 0;
+	for (unsigned int i = 0; bytesRead > 0 && copied < (unsigned int)bytesRead; i++)
+	{
+		unsigned int size = iov[i].len < bytesRead - copied ? iov[i].len : bytesRead - copied;
+		memcpy(iov[i].base, &buf[copied], size);
+		copied += size;
+	}
+	free(buf);
+	if (bytesRead > 0)
+		openFile->cursor += bytesRead;
+	return bytesRead;
+}
+
+// Funcao para a escrita vetorizada de um arquivo, a partir de um descritor
+// de arquivo existente. Os trechos sao reunidos e gravados por uma unica
+// escrita, com um so mapeamento de blocos e uma so gravacao do i-node.
+// Retorna o numero de bytes efetivamente escritos em caso de sucesso ou -1,
+// caso contrario
+int myFSWritev(int fd, const FSIOVec *iov, unsigned int iovcnt)
+{
+	FileDescriptor *openFile = getFileDescriptor(fd);
+	int total = iovecTotalLength(iov, iovcnt);
+	if (openFile == NULL || total == -1 || loadFSData(openFile->file->disk) == -1)
+		return -1;
+	if (iovcnt == 1)
+		return myFSWrite(fd, iov[0].base, iov[0].len);
+	char *buf = malloc(total > 0 ? total : 1);
+	if (buf == NULL)
+		return -1;
+	unsigned int copied = 0;
+	for (unsigned int i = 0; i < iovcnt; i++)
+	{
+		memcpy(&buf[copied], iov[i].base, iov[i].len);
+		copied += iov[i].len;
+	}
+	int bytesWritten = writeAtCursor(openFile, buf, total);
+	free(buf);
+	return bytesWritten;
+}
+
+// Funcao para a leitura de um arquivo a partir da posicao offset, de 64
+// bits, sem uso nem alteracao do cursor do descritor. Retorna o numero de
+// bytes efetivamente lidos em caso de sucesso ou -1, caso contrario
+int myFSPread64(int fd, char *buf, unsigned int nbytes, unsigned long long offset)
+{
+	FileDescriptor *openFile = getFileDescriptor(fd);
+	if (openFile == NULL || loadFSData(openFile->file->disk) == -1)
+		return -1;
+	return readFileAt(openFile, buf, nbytes, offset);
+}
+
+// Funcao para a leitura de um arquivo a partir da posicao offset, sem
+// uso nem alteracao do cursor do descritor. Retorna o numero de bytes
+// efetivamente lidos em caso de sucesso ou -1, caso contrario
+int myFSPread(int fd, char *buf, unsigned int nbytes, unsigned int offset)
+{
+	return myFSPread64(fd, buf, nbytes, offset);
+}
+
+// Funcao para a escrita de um arquivo a partir da posicao offset, de 64
+// bits, sem uso nem alteracao do cursor do descritor. Retorna o numero de
+// bytes efetivamente escritos em caso de sucesso ou -1, caso contrario
+int myFSPwrite64(int fd, const char *buf, unsigned int nbytes, unsigned long long offset)
+{
+	FileDescriptor *openFile = getFileDescriptor(fd);
+	if (openFile == NULL || loadFSData(openFile->file->disk) == -1)
+		return -1;
+	return writeFileAt(openFile->file, buf, nbytes, offset);
+}
+
+// Funcao para a escrita de um arquivo a partir da posicao offset, sem
+// uso nem alteracao do cursor do descritor. Retorna o numero de bytes
+// efetivamente escritos em caso de sucesso ou -1, caso contrario
+int myFSPwrite(int fd, const char *buf, unsigned int nbytes, unsigned int offset)
+{
+	return myFSPwrite64(fd, buf, nbytes, offset);
+}
+
+// Funcao para posicionar o cursor de um arquivo aberto em offset, de 64
+// bits. O cursor pode ultrapassar o fim do arquivo, mas nao o maior tamanho
+// de arquivo suportado. Retorna a nova posicao do cursor em caso de sucesso
+// ou -1, caso contrario
+long long myFSSeek64(int fd, unsigned long long offset)
+{
+	FileDescriptor *openFile = getFileDescriptor(fd);
+	if (openFile == NULL || loadFSData(openFile->file->disk) == -1 || offset > maxFileSize())
+		return -1;
+	openFile->cursor = offset;
+	return offset;
+}
+
+// Funcao para posicionar o cursor de um arquivo aberto em offset. O cursor
+// pode ultrapassar o fim do arquivo; uma escrita nessa posicao deixa um
+// buraco, lido como zeros e sem blocos em disco. Posicoes acima de INT_MAX,
+// que nao caberiam no retorno, sao rejeitadas; para elas usa-se myFSSeek64.
+// Retorna a nova posicao do cursor em caso de sucesso ou -1, caso contrario
+int myFSSeek(int fd, unsigned int offset)
+{
+	if (offset > INT_MAX || myFSSeek64(fd, offset) == -1)
+		return -1;
+	return (int)offset;
+}
+
+// Garante que os bytes de offset ate offset + nbytes do arquivo possuam
+// blocos em disco, escolhidos de forma contigua sempre que possivel; buracos
+// no intervalo sao preenchidos com blocos zerados. O tamanho do arquivo nao
+// e' alterado. Retorna 0 caso bem sucedido, ou -1 caso contrario
+int allocateFileRange(OpenInode *file, unsigned long long offset, unsigned long long nbytes)
+{
+	if (offset > maxFileSize() || nbytes > maxFileSize() - offset)
+		return -1;
+	if (flushDelayedBlocks(file) == -1)
+		return -1;
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned int firstBlock = offset / blockSize;
+	unsigned int lastBlock = divideCeil(offset + nbytes, blockSize);
+	if (firstBlock >= lastBlock)
+		return 0;
+	unsigned int *blockAddrs = calloc(lastBlock - firstBlock, sizeof(unsigned int));
+	if (blockAddrs == NULL)
+		return -1;
+	if (firstBlock < file->numAllocatedBlocks)
+	{
+		unsigned int mappedEnd = lastBlock < file->numAllocatedBlocks ? lastBlock : file->numAllocatedBlocks;
+		inodeGetBlockAddrs(file->inode, firstBlock, mappedEnd - firstBlock, blockAddrs);
+	}
+	unsigned int numBlocks = 0, firstHole = lastBlock;
+	for (unsigned int i = lastBlock - firstBlock; i > 0; i--)
+		if (blockAddrs[i - 1] == 0)
+		{
+			numBlocks++;
+			firstHole = firstBlock + i - 1;
+		}
+	unsigned int *blocks = malloc(numBlocks * sizeof(unsigned int));
+	unsigned int goal = firstHole > 0 && firstHole <= file->numAllocatedBlocks ? inodeGetBlockAddr(file->inode, firstHole - 1) : 0;
+	if (numBlocks == 0 || blocks == NULL ||
+		allocateBlocks(file->disk, goal != 0 ? goal + 1 : extentGoal(file), numBlocks, blocks) == -1)
+	{
+		free(blockAddrs);
+		free(blocks);
+		return numBlocks == 0 ? 0 : -1;
+	}
+
+	// buracos abaixo do fim do arquivo eram lidos como zeros e assim devem
+	// continuar; blocos alem do fim sao zerados quando uma escrita os alcanca
+	unsigned long long fileSize = inodeGetFileSize(file->inode);
+	unsigned int numAdded = 0;
+	for (unsigned int block = firstHole; block < lastBlock && numAdded < numBlocks; block++)
+	{
+		if (blockAddrs[block - firstBlock] != 0)
+			continue;
+		if ((unsigned long long)block * blockSize < fileSize)
+		{
+			unsigned char *blockData = cachePin(blocks[numAdded], 0);
+			if (blockData == NULL)
+				break;
+			memset(blockData, 0, blockSize);
+			cacheUnpin(blocks[numAdded], 1);
+		}
+		if (setInodeBlock(file->inode, file->numAllocatedBlocks, block, blocks[numAdded]) == -1)
+			break;
+		if (block >= file->numAllocatedBlocks)
+			file->numAllocatedBlocks = block + 1;
+		numAdded++;
+	}
+	setBlocksStatus(numAdded, blocks, 1);
+	free(blockAddrs);
+	free(blocks);
+	if (saveBitmap(file->disk) == -1 || numAdded != numBlocks)
+		return -1;
+	return 0;
+}
+
+// Funcao para pre-alocacao de espaco de um arquivo, com offset e nbytes de
+// 64 bits. Mesmo comportamento de myFSAllocate
+int myFSAllocate64(int fd, unsigned long long offset, unsigned long long nbytes)
+{
+	FileDescriptor *openFile = getFileDescriptor(fd);
+	if (openFile == NULL)
+		return -1;
+	OpenInode *file = openFile->file;
+	if (loadFSData(file->disk) == -1)
+		return -1;
+	return allocateFileRange(file, offset, nbytes);
+}
+
+// Funcao para pre-alocacao de espaco de um arquivo, a partir de um
+// descritor de arquivo existente. Garante que os bytes de offset ate
+// offset + nbytes possuam blocos em disco, escolhidos de forma contigua
+// sempre que possivel; buracos no intervalo sao preenchidos com blocos
+// zerados. O tamanho do arquivo nao e' alterado. Retorna 0 caso bem
+// sucedido, ou -1 caso contrario
+int myFSAllocate(int fd, unsigned int offset, unsigned int nbytes)
 {
-	if (loadFSData(d) == -1)
-		return -1;
-	char **entries = NULL;
-	int numEntries = splitPath(path, &entries);
+	return myFSAllocate64(fd, offset, nbytes);
+}
 
-	if (numEntries == -1)
+// Funcao para copiar nbytes do arquivo fdIn, a partir de offsetIn, para o
+// arquivo fdOut, a partir de offsetOut, sem passar por buffers do chamador e
+// sem alterar os cursores. O trecho de destino e' alocado de uma vez, como
+// uma extensao contigua sempre que possivel, e os dados sao transferidos em
+// trechos de ate COPY_CHUNK_BLOCKS blocos, com leitura antecipada na origem.
+// Trechos sobrepostos de um mesmo arquivo nao sao aceitos. Retorna o numero
+// de bytes copiados em caso de sucesso ou -1, caso contrario
+int myFSCopyRange64(int fdIn, unsigned long long offsetIn, int fdOut, unsigned long long offsetOut, unsigned int nbytes)
+{
+	FileDescriptor *in = getFileDescriptor(fdIn);
+	FileDescriptor *out = getFileDescriptor(fdOut);
+	if (in == NULL || out == NULL || loadFSData(in->file->disk) == -1)
+		return -1;
+	if (inodeGetFileType(in->file->inode) != FILETYPE_REGULAR || inodeGetFileType(out->file->inode) != FILETYPE_REGULAR)
+		return -1;
+	unsigned long long fileSize = inodeGetFileSize(in->file->inode);
+	if (offsetIn >= fileSize || nbytes == 0)
+		return 0;
+	if (nbytes > fileSize - offsetIn)
+		nbytes = fileSize - offsetIn;
+	if (nbytes > INT_MAX || offsetOut > maxFileSize() || nbytes > maxFileSize() - offsetOut)
+		return -1;
+	if (in->file == out->file && offsetIn < offsetOut + nbytes && offsetOut < offsetIn + nbytes)
 		return -1;
 
-	Inode *inodeDir = inodeRoot;
-	Directory *dir = loadDirectory(d, inodeRoot);
-	for (int i = 0; i < numEntries - 1; i++)
+	// blocos pendentes da origem precisam de endereco para a leitura em
+	// sequencia; o destino recebe todos os blocos antes da copia
+	if (flushDelayedBlocks(in->file) == -1 || allocateFileRange(out->file, offsetOut, nbytes) == -1)
+		return -1;
+	unsigned int chunkSize = COPY_CHUNK_BLOCKS * superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	char *buf = malloc(chunkSize);
+	if (buf == NULL)
+		return -1;
+	// leitura com estado de leitura antecipada proprio, sem alterar o do descritor
+	FileDescriptor view = *in;
+	view.nextReadBlock = 0;
+	view.readaheadWindow = 0;
+	view.readaheadEnd = 0;
+	unsigned int copied = 0;
+	while (copied < nbytes)
 	{
-		unsigned int inodeNumber = findInodeNumber(dir, entries[i]);
-		if (inodeNumber == 0)
+		unsigned int size = nbytes - copied < chunkSize ? nbytes - copied : chunkSize;
+		int bytesRead = readFileAt(&view, buf, size, offsetIn + copied);
+		if (bytesRead <= 0)
 			break;
-		if (inodeDir != inodeRoot)
-			free(inodeDir);
-		inodeDir = inodeLoad(inodeNumber, d);
-		if (inodeDir == NULL || inodeGetFileType(inodeDir) != FILETYPE_DIR)
-			break;
-		freeDirectory(dir);
-		dir = loadDirectory(d, inodeDir);
-		if (dir == NULL)
+		int bytesWritten = writeFileAt(out->file, buf, bytesRead, offsetOut + copied);
+		if (bytesWritten > 0)
+			copied += bytesWritten;
+		if (bytesWritten != bytesRead)
 			break;
 	}
-	Inode *inodeFile;
+	free(buf);
+	if (copied == 0)
+		return -1;
+	return copied;
+}
+
+// Funcao para copiar nbytes do arquivo fdIn, a partir de offsetIn, para o
+// arquivo fdOut, a partir de offsetOut. Mesmo comportamento de
+// myFSCopyRange64, com posicoes de 32 bits
+int myFSCopyRange(int fdIn, unsigned int offsetIn, int fdOut, unsigned int offsetOut, unsigned int nbytes)
+{
+	return myFSCopyRange64(fdIn, offsetIn, fdOut, offsetOut, nbytes);
+}
+
+// Funcao para alterar o tamanho de um arquivo aberto para size bytes. Ao
+// crescer, o trecho novo fica como buraco. Ao diminuir, os blocos alem do
+// novo fim sao apenas desligados do i-node e enfileirados; a devolucao ao
+// bitmap e a liberacao das extensoes ocorrem depois, em reclaimSpace. O
+// primeiro bloco do arquivo e' sempre mantido. Retorna 0 caso bem sucedido,
+// ou -1 caso contrario
+int myFSTruncate64(int fd, unsigned long long size)
+{
+	FileDescriptor *openFile = getFileDescriptor(fd);
+	if (openFile == NULL)
+		return -1;
+	OpenInode *file = openFile->file;
+	if (inodeGetFileType(file->inode) != FILETYPE_REGULAR || loadFSData(file->disk) == -1 || size > maxFileSize())
+		return -1;
+	// o bloco final fixado pode deixar de existir
+	if (releaseTailBlock(file) == -1)
+		return -1;
+	unsigned long long fileSize = inodeGetFileSize(file->inode);
+	if (size > fileSize && zeroFileRange(file, fileSize, size) == -1)
+		return -1;
 
-	if (dir != NULL)
+	unsigned int keepBlocks = divideCeil(size, superblock[SUPERBLOCK_ITEM_BLOCKSIZE]);
+	if (keepBlocks == 0)
+		keepBlocks = 1;
+	unsigned int delayedEnd = file->delayedStart + file->numDelayedBlocks;
+	if (file->numDelayedBlocks > 0 && delayedEnd > keepBlocks)
 	{
-		unsigned int inodeNumber = findInodeNumber(dir, entries[numEntries - 1]);
-		freeDirectory(dir);
-		if (inodeNumber != 0)
-			inodeFile = inodeLoad(inodeNumber, d);
-		else
+		// blocos postergados alem do novo fim sao descartados sem ir ao disco
+		unsigned int numKept = file->delayedStart < keepBlocks ? keepBlocks - file->delayedStart : 0;
+		reservedBlocks -= file->numDelayedBlocks - numKept;
+		file->numDelayedBlocks = numKept;
+		reserveDelayedInodes(file);
+		if (numKept == 0)
 		{
-			inodeNumber = inodeFindFreeInode(ROOT_INODE_NUMBER + 1, d);
-			if (inodeNumber != 0)
-			{
-				inodeFile = inodeLoad(inodeNumber, d);
-				if (inodeFile != NULL)
-				{
-					inodeSetFileType(inodeFile, FILETYPE_REGULAR);
-					inodeSetFileSize(inodeFile, 0);
-					inodeSetGroupOwner(inodeFile, 0);
-					inodeSetOwner(inodeFile, 0);
-					inodeSetPermission(inodeFile, 0);
-					unsigned int blocks[1];
-					if (findFreeBlocks(1, blocks) == -1)
-					{
-						free(inodeFile);
-						inodeFile = NULL;
-					}
-					else
-					{
-						inodeAddBlock(inodeFile, blocks[0]);
-						setBlocksStatus(1, blocks, 1);
-						saveBitmap(d);
-					}
-					if (inodeFile != NULL && addDirectoryEntry(d, inodeDir, inodeFile, entries[numEntries - 1]) == -1)
-					{
-						free(inodeFile);
-						inodeFile = NULL;
-					}
-				}
-			}
+			free(file->delayedData);
+			file->delayedData = NULL;
 		}
 	}
-
-	unsigned int fd = 0;
-	if (inodeFile != NULL)
+	if (file->numAllocatedBlocks > keepBlocks)
 	{
-		for (unsigned int i = 0; i < numOpenFiles; i++)
+		unsigned int *addrs = malloc(inodeNumItemsPerExtension() * sizeof(unsigned int));
+		if (addrs == NULL)
+			return -1;
+		unsigned int chain = 0;
+		int numAddrs = inodeTruncateBlocks(file->inode, keepBlocks, addrs, &chain);
+		if (numAddrs == -1 || queueReclaim(numAddrs, addrs, chain) == -1)
 		{
-			if (openFiles[i]->inode == inodeFile)
-			{
-				fd = openFiles[i]->fd;
-				break;
-			}
+			free(addrs);
+			return -1;
 		}
-		if (fd == 0)
+		free(addrs);
+		file->numAllocatedBlocks = inodeGetBlockCount(file->inode);
+		openFile->readaheadEnd = 0;
+	}
+
+	inodeSetFileSize(file->inode, size);
+	if (file->numDelayedBlocks == 0 && inodeSave(file->inode) == -1)
+		return -1;
+	return 0;
+}
+
+// Funcao para alterar o tamanho de um arquivo aberto para size bytes. Mesmo
+// comportamento de myFSTruncate64, com tamanho de 32 bits
+int myFSTruncate(int fd, unsigned int size)
+{
+	return myFSTruncate64(fd, size);
+}
+
+// Retorna o mapeamento que contem os nbytes a partir de addr, ou NULL se o
+// trecho nao pertencer inteiramente a um mapeamento
+Mapping *findMapping(const char *addr, unsigned int nbytes)
+{
+	unsigned int blockSize = superblock != NULL ? superblock[SUPERBLOCK_ITEM_BLOCKSIZE] : 0;
+	for (Mapping *map = mappings; map != NULL; map = map->next)
+	{
+		unsigned int mapSize = map->numPages * blockSize;
+		if (addr >= map->data && addr < map->data + mapSize &&
+			nbytes <= mapSize - (unsigned int)(addr - map->data))
+			return map;
+	}
+	return NULL;
+}
+
+// Grava no arquivo as paginas modificadas de [firstPage, lastPage) do
+// mapeamento, em trechos contiguos. Bytes alem do fim do arquivo nao sao
+// gravados, como em um mapeamento que nao altera o tamanho do arquivo.
+// Retorna 0 caso bem sucedido, ou -1 caso contrario
+int writeMappedPages(Mapping *map, unsigned int firstPage, unsigned int lastPage)
+{
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned long long fileSize = inodeGetFileSize(map->view.file->inode);
+	int ret = 0;
+	unsigned int page = firstPage;
+	while (page < lastPage)
+	{
+		if (map->pageState[page] != MAP_PAGE_DIRTY)
 		{
-			FileDescriptor *newFileDescriptor = createFileDescriptor(d, inodeFile);
-			if (newFileDescriptor != NULL)
-				fd = newFileDescriptor->fd;
+			page++;
+			continue;
 		}
+		unsigned int runEnd = page;
+		while (runEnd < lastPage && map->pageState[runEnd] == MAP_PAGE_DIRTY)
+			map->pageState[runEnd++] = MAP_PAGE_LOADED;
+		unsigned long long from = map->offset + (unsigned long long)page * blockSize;
+		unsigned long long to = map->offset + (unsigned long long)runEnd * blockSize;
+		if (to > fileSize)
+			to = fileSize;
+		if (from < to && writeFileAt(map->view.file, &map->data[page * blockSize], to - from, from) != (int)(to - from))
+			ret = -1;
+		page = runEnd;
 	}
+	return ret;
+}
+
+// Grava as paginas modificadas de todos os mapeamentos do arquivo. Retorna 0
+// caso bem sucedido, ou -1 caso contrario
+int syncMappings(OpenInode *file)
+{
+	int ret = 0;
+	for (Mapping *map = mappings; map != NULL; map = map->next)
+		if ((file == NULL || map->view.file == file) && writeMappedPages(map, 0, map->numPages) == -1)
+			ret = -1;
+	return ret;
+}
 
-	if (entries != NULL)
+// Funcao para mapear em memoria length bytes de um arquivo aberto, a partir
+// de offset, que deve ser multiplo do tamanho do bloco. As paginas sao
+// carregadas sob demanda, por myFSMfault. O mapeamento mantem o arquivo
+// aberto ate myFSMunmap, mesmo que o descritor seja fechado. Retorna o
+// endereco do mapeamento ou NULL em caso de falha
+char *myFSMmap64(int fd, unsigned long long offset, unsigned int length)
+{
+	FileDescriptor *openFile = getFileDescriptor(fd);
+	if (openFile == NULL || length == 0 || loadFSData(openFile->file->disk) == -1)
+		return NULL;
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	if (inodeGetFileType(openFile->file->inode) != FILETYPE_REGULAR || offset % blockSize != 0 ||
+		length > INT_MAX || offset > maxFileSize() || length > maxFileSize() - offset)
+		return NULL;
+	Mapping *map = malloc(sizeof(Mapping));
+	if (map == NULL)
+		return NULL;
+	map->offset = offset;
+	map->numPages = divideCeil(length, blockSize);
+	map->data = malloc(map->numPages * blockSize);
+	map->pageState = calloc(map->numPages, sizeof(unsigned char));
+	if (map->data == NULL || map->pageState == NULL)
 	{
-		for (int i = 0; i < numEntries; i++)
-			free(entries[i]);
-		free(entries);
+		free(map->data);
+		free(map->pageState);
+		free(map);
+		return NULL;
 	}
-	if (inodeDir != NULL && inodeDir != inodeRoot)
-		free(inodeDir);
+	map->view.fd = 0;
+	map->view.file = openFile->file;
+	map->view.file->refs++;
+	map->view.cursor = 0;
+	map->view.append = 0;
+	map->view.nextReadBlock = 0;
+	map->view.readaheadWindow = 0;
+	map->view.readaheadEnd = 0;
+	map->view.dirName = NULL;
+	map->next = mappings;
+	mappings = map;
+	return map->data;
+}
 
-	return fd;
+// Funcao para mapear em memoria length bytes de um arquivo aberto, a partir
+// de offset. Mesmo comportamento de myFSMmap64, com posicao de 32 bits
+char *myFSMmap(int fd, unsigned int offset, unsigned int length)
+{
+	return myFSMmap64(fd, offset, length);
 }
 
-// Funcao para a leitura de um arquivo, a partir de um descritor de
-// arquivo existente. Os dados lidos sao copiados para buf e terao
-// tamanho maximo de nbytes. Retorna o numero de bytes efetivamente
-// lidos em caso de sucesso ou -1, caso contrario.
-int myFSRead(int fd, char *buf, unsigned int nbytes)
+// Funcao para garantir que as paginas do mapeamento que contem os nbytes a
+// partir de addr estejam carregadas. Paginas ausentes e consecutivas sao
+// lidas de uma vez; trechos alem do fim do arquivo sao lidos como zeros. Se
+// write for diferente de 0, as paginas sao marcadas como modificadas e serao
+// gravadas em myFSMsync, no fechamento do arquivo ou em myFSMunmap. Retorna 0
+// caso bem sucedido, ou -1 caso contrario
+int myFSMfault(char *addr, unsigned int nbytes, int write)
 {
-	FileDescriptor *openFile = getFileDescriptor(fd);
-	if (openFile == NULL || loadFSData(openFile->disk) == -1)
+	Mapping *map = findMapping(addr, nbytes);
+	if (map == NULL)
 		return -1;
-	unsigned int sizeToRead = nbytes > inodeGetFileSize(openFile->inode) ? inodeGetFileSize(openFile->inode) : nbytes;
-	unsigned int numBlocks = divideCeil(sizeToRead, superblock[SUPERBLOCK_ITEM_BLOCKSIZE]);
-	unsigned int offset = 0;
-	unsigned char *blockBuffer = malloc(superblock[SUPERBLOCK_ITEM_BLOCKSIZE]);
-	for (unsigned int i = 0; i < numBlocks; i++)
+	if (nbytes == 0)
+		return 0;
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned int firstPage = (addr - map->data) / blockSize;
+	unsigned int lastPage = divideCeil((addr - map->data) + nbytes, blockSize);
+	unsigned int page = firstPage;
+	while (page < lastPage)
 	{
-		if (i + 1 == numBlocks)
-		{
-			if (readBlock(openFile->disk, inodeGetBlockAddr(openFile->inode, i), blockBuffer) == -1)
-				break;
-			memcpy(&buf[offset], blockBuffer, sizeToRead - offset);
-			offset += sizeToRead - offset;
-		}
-		else
+		if (map->pageState[page] != MAP_PAGE_ABSENT)
 		{
-			if (readBlock(openFile->disk, inodeGetBlockAddr(openFile->inode, i), &buf[offset]) == -1)
-				break;
-			offset += superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+			page++;
+			continue;
 		}
+		unsigned int runEnd = page;
+		while (runEnd < lastPage && map->pageState[runEnd] == MAP_PAGE_ABSENT)
+			runEnd++;
+		unsigned int runSize = (runEnd - page) * blockSize;
+		char *runData = &map->data[page * blockSize];
+		int bytesRead = readFileAt(&map->view, runData, runSize, map->offset + (unsigned long long)page * blockSize);
+		if (bytesRead == -1)
+			return -1;
+		memset(&runData[bytesRead], 0, runSize - bytesRead);
+		for (; page < runEnd; page++)
+			map->pageState[page] = MAP_PAGE_LOADED;
 	}
-	free(blockBuffer);
-	if (offset != sizeToRead)
+	if (write)
+		memset(&map->pageState[firstPage], MAP_PAGE_DIRTY, lastPage - firstPage);
+	return 0;
+}
+
+// Funcao para gravar no arquivo as paginas modificadas do mapeamento que
+// contem os nbytes a partir de addr. Retorna 0 caso bem sucedido, ou -1 caso
+// contrario
+int myFSMsync(char *addr, unsigned int nbytes)
+{
+	Mapping *map = findMapping(addr, nbytes);
+	if (map == NULL)
 		return -1;
-	return offset;
+	unsigned int blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	unsigned int firstPage = (addr - map->data) / blockSize;
+	unsigned int lastPage = divideCeil((addr - map->data) + nbytes, blockSize);
+	return writeMappedPages(map, firstPage, lastPage);
 }
 
-// Funcao para a escrita de um arquivo, a partir de um descritor de
-// arquivo existente. Os dados de buf serao copiados para o disco e
-// terao tamanho maximo de nbytes. Retorna o numero de bytes
-// efetivamente escritos em caso de sucesso ou -1, caso contrario
-int myFSWrite(int fd, const char *buf, unsigned int nbytes)
+// Funcao para desfazer o mapeamento iniciado em addr, gravando antes as
+// paginas modificadas. Retorna 0 caso bem sucedido, ou -1 caso contrario
+int myFSMunmap(char *addr)
 {
-	FileDescriptor *openFile = getFileDescriptor(fd);
-	if (openFile == NULL || loadFSData(openFile->disk) == -1)
+	Mapping **link = &mappings;
+	while (*link != NULL && (*link)->data != addr)
+		link = &(*link)->next;
+	if (*link == NULL)
 		return -1;
+	Mapping *map = *link;
+	int ret = writeMappedPages(map, 0, map->numPages);
+	*link = map->next;
+	if (putOpenInode(map->view.file) == -1)
+		ret = -1;
+	free(map->data);
+	free(map->pageState);
+	free(map);
+	return ret;
+}
 
-	unsigned int bufferOffset = 0;
-	unsigned int cursorBlock = openFile->cursor / superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
-	unsigned int cursorBlockOffset = openFile->cursor % superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
-	unsigned char *blockBuffer = malloc(superblock[SUPERBLOCK_ITEM_BLOCKSIZE]);
-	unsigned int blockAddr = inodeGetBlockAddr(openFile->inode, cursorBlock);
-	unsigned int sizeToWriteInCursorBlock = superblock[SUPERBLOCK_ITEM_BLOCKSIZE] - cursorBlockOffset;
-	if (sizeToWriteInCursorBlock > nbytes)
-		sizeToWriteInCursorBlock = nbytes;
-	if (blockAddr != 0)
+// Funcao para obtencao de informacoes de ocupacao do sistema de arquivos
+// montado no disco d. Os contadores sao mantidos no superbloco, entao a
+// consulta nao percorre bitmap nem i-nodes. Blocos reservados para alocacao
+// postergada nao sao contados como livres. Retorna 0 caso bem sucedido, ou
+// -1 caso contrario
+int myFSStatfs(Disk *d, FSStat *st)
+{
+	if (st == NULL || loadFSData(d) == -1)
+		return -1;
+	st->blockSize = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
+	st->numBlocks = superblock[SUPERBLOCK_ITEM_NUMBLOCKS];
+	st->numFreeBlocks = superblock[SUPERBLOCK_ITEM_FREEBLOCKS] - reservedBlocks;
+	st->numInodes = superblock[SUPERBLOCK_ITEM_NUMINODES];
+	st->numFreeInodes = superblock[SUPERBLOCK_ITEM_FREEINODES] - reservedInodes;
+	return 0;
+}
+
+// Funcao para sincronizacao do sistema de arquivos montado no disco d.
+// Aloca os blocos pendentes dos arquivos abertos e grava em disco todos
+// os blocos modificados do cache. Retorna 0 caso bem sucedido, ou -1 caso
+// contrario
+int myFSSync(Disk *d)
+{
+	if (loadFSData(d) == -1)
+		return -1;
+	int ret = syncMappings(NULL);
+	for (unsigned int i = 0; i < OPEN_INODE_HASH_SIZE; i++)
 	{
-		if (readBlock(openFile->disk, blockAddr, blockBuffer) == -1)
-		{
-			free(blockBuffer);
-			return -1;
-		}
-		for (unsigned int i = 0; i < sizeToWriteInCursorBlock; i++)
-		{
-			blockBuffer[cursorBlockOffset] = buf[bufferOffset];
-			bufferOffset++;
-			cursorBlockOffset++;
-		}
-		if (writeBlock(openFile->disk, blockAddr, blockBuffer, superblock[SUPERBLOCK_ITEM_BLOCKSIZE]) == -1)
+		OpenInode *next;
+		for (OpenInode *file = openInodes[i]; file != NULL; file = next)
 		{
-			free(blockBuffer);
-			return -1;
+			next = file->hashNext;
+			if (file->disk != d)
+				continue;
+			if (releaseTailBlock(file) == -1 || flushDelayedBlocks(file) == -1)
+				ret = -1;
+			// i-nodes ja fechados, mantidos por uma falha anterior ao gravar
+			// seus blocos, sao liberados quando a gravacao tem sucesso
+			else if (file->refs == 0)
+				forgetOpenInode(file);
 		}
-		cursorBlock++;
+	}
+	if (reclaimSpace(d, RECLAIM_ALL) == -1)
+		ret = -1;
+	if (cacheSync() == -1)
+		return -1;
+	return ret;
+}
+
+// Funcao para fechar um arquivo, a partir de um descritor de arquivo
+// existente. Retorna 0 caso bem sucedido, ou -1 caso contrario
+int myFSClose(int fd)
+{
+	FileDescriptor *fileToRemove = getFileDescriptor(fd);
+	if (fileToRemove == NULL)
+		return -1;
+	removeFileDescriptor(fileToRemove);
+	Disk *d = fileToRemove->file->disk;
+	// paginas modificadas de mapeamentos do arquivo vao para o disco, mas os
+	// mapeamentos continuam validos ate myFSMunmap
+	int ret = syncMappings(fileToRemove->file);
+	if (fileToRemove->append && releaseTailBlock(fileToRemove->file) == -1)
+		ret = -1;
+	// no ultimo fechamento de um arquivo removido enquanto aberto, os blocos
+	// pendentes sao descartados e o i-node e' liberado
+	if (putOpenInode(fileToRemove->file) == -1)
+		ret = -1;
+	free(fileToRemove->dirName);
+	free(fileToRemove);
+	// sem arquivos abertos, parte do espaco pendente e' recuperada
+	if (numOpenFiles == 0 && reclaimSpace(d, RECLAIM_IDLE_EXTENSIONS) == -1)
+		ret = -1;
+	return ret;
+}
+
+// Retorna o descritor de um diretorio aberto ou NULL se fd nao for um
+// diretorio aberto
+FileDescriptor *getDirDescriptor(int fd)
+{
+	FileDescriptor *openFile = getFileDescriptor(fd);
+	if (openFile == NULL || loadFSData(openFile->file->disk) == -1)
+		return NULL;
+	if (inodeGetFileType(openFile->file->inode) != FILETYPE_DIR)
+		return NULL;
+	return openFile;
+}
+
+// Funcao para abertura de um diretorio, a partir do caminho
+// especificado em path, no disco indicado por d, no modo Read/Write,
+// criando o diretorio se nao existir. Retorna um descritor de arquivo,
+// em caso de sucesso. Retorna -1, caso contrario.
+int myFSOpenDir(Disk *d, const char *path)
+{
+	if (loadFSData(d) == -1)
+		return -1;
+	char name[MAX_FILENAME_LENGTH];
+	OpenInode *parent = walkPath(d, path, name);
+	if (parent == NULL)
+		return -1;
 
-		unsigned int numBlocks = divideCeil((nbytes - bufferOffset), superblock[SUPERBLOCK_ITEM_BLOCKSIZE]);
-		unsigned int *newBlocks = NULL;
-		unsigned int newBlocksOffset = 0;
-		for (unsigned int i = 0; i < numBlocks; i++)
+	OpenInode *dirFile = NULL;
+	if (name[0] == '\0')
+	{
+		dirFile = openRoot;
+		dirFile->refs++;
+	}
+	else
+	{
+		unsigned int inodeNumber = lookupEntry(d, parent->inode, name);
+		if (inodeNumber != 0)
 		{
-			unsigned int sizeToWrite = nbytes - bufferOffset;
-			if (sizeToWrite > superblock[SUPERBLOCK_ITEM_BLOCKSIZE])
-				sizeToWrite = superblock[SUPERBLOCK_ITEM_BLOCKSIZE];
-			blockAddr = inodeGetBlockAddr(openFile->inode, cursorBlock);
-			if (blockAddr != 0)
+			dirFile = getOpenInode(d, inodeNumber);
+			if (dirFile != NULL && inodeGetFileType(dirFile->inode) != FILETYPE_DIR)
 			{
-				if (writeBlock(openFile->disk, blockAddr, &buf[bufferOffset], sizeToWrite) == -1)
-					break;
-				bufferOffset += sizeToWrite;
+				putOpenInode(dirFile);
+				dirFile = NULL;
 			}
+		}
+		else if ((inodeNumber = findFreeInode(d)) != 0 && (dirFile = getOpenInode(d, inodeNumber)) != NULL)
+		{
+			int linkedParent = createDirectory(d, dirFile->inode) == 0 &&
+							   addDirectoryEntry(d, dirFile->inode, parent->inode, "..") == 0;
+			if (linkedParent && addDirectoryEntry(d, parent->inode, dirFile->inode, name) == 0)
+				dirFile->numAllocatedBlocks = inodeGetBlockCount(dirFile->inode);
 			else
 			{
-				if (newBlocks == NULL)
+				// o ".." conta como referencia ao pai, que e' desfeita; sem
+				// referencias, nem mesmo a do ".", o diretorio e' liberado ao
+				// soltar a referencia
+				if (linkedParent)
 				{
-					unsigned int numNewBlocks = divideCeil((nbytes - bufferOffset), superblock[SUPERBLOCK_ITEM_BLOCKSIZE]);
-					newBlocks = malloc(numNewBlocks * sizeof(unsigned int));
-					if (newBlocks == NULL || findFreeBlocks(numNewBlocks, newBlocks) == -1)
-						break;
+					inodeSetRefCount(parent->inode, inodeGetRefCount(parent->inode) - 1);
+					inodeSave(parent->inode);
 				}
-				if (writeBlock(openFile->disk, newBlocks[newBlocksOffset], &buf[bufferOffset], sizeToWrite) == -1)
-					break;
-				inodeAddBlock(openFile->inode, newBlocks[newBlocksOffset]);
-				newBlocksOffset++;
-				bufferOffset += sizeToWrite;
+				inodeSetRefCount(dirFile->inode, 0);
+				putOpenInode(dirFile);
+				dirFile = NULL;
 			}
 		}
-		free(blockBuffer);
-		if (newBlocks != NULL)
-		{
-			setBlocksStatus(newBlocksOffset, newBlocks, 1);
-			saveBitmap(openFile->disk);
-			free(newBlocks);
-		}
-		inodeSetFileSize(openFile->inode, inodeGetFileSize(openFile->inode) + bufferOffset);
-		inodeSave(openFile->inode);
-		openFile->cursor += bufferOffset;
-		return bufferOffset;
 	}
+	putOpenInode(parent);
+	if (dirFile == NULL)
+		return -1;
+
+	FileDescriptor *openFile = createFileDescriptor(dirFile);
+	if (openFile == NULL)
+	{
+		putOpenInode(dirFile);
+		return -1;
+	}
+	return openFile->fd;
 }
 
-// Funcao para fechar um arquivo, a partir de um descritor de arquivo
-// existente. Retorna 0 caso bem sucedido, ou -1 caso contrario
-int myFSClose(int fd)
+// Le ate maxEntries entradas, em ordem de nome, de um diretorio aberto com
+// arvore de nomes, a partir do nome seguinte ao ultimo lido ou do inicio se o
+// cursor for 0, ou de prefix, se for maior. Retorna o numero de entradas
+// lidas, 0 no fim ou -1 em caso de falha
+int readDirTreeEntries(FileDescriptor *openFile, Inode *tree, const char *prefix, FSDirent *entries,
+					   unsigned int maxEntries)
 {
-	FileDescriptor *fileToRemove = NULL;
-	for (int i = 0; i < numOpenFiles; i++)
+	if (openFile->dirName == NULL && (openFile->dirName = malloc(MAX_FILENAME_LENGTH + 1)) == NULL)
+		return -1;
+	const char *start = "";
+	int inclusive = 1;
+	if (openFile->cursor != 0)
 	{
-		if (openFiles[i]->fd == fd)
-			fileToRemove = openFiles[i];
-		if (fileToRemove != NULL)
-			openFiles[i] = openFiles[i + 1];
+		start = openFile->dirName;
+		inclusive = 0;
 	}
-	if (fileToRemove == NULL)
-		return -1;
-	free(fileToRemove->inode);
-	free(fileToRemove);
-	numOpenFiles--;
-	return 0;
+	if (prefix != NULL && strcmp(start, prefix) < 0)
+	{
+		start = prefix;
+		inclusive = 1;
+	}
+	int count = scanDirTree(tree, start, inclusive, prefix, entries, maxEntries);
+	if (count > 0)
+	{
+		strcpy(openFile->dirName, entries[count - 1].name);
+		openFile->cursor = 1;
+	}
+	return count;
 }
 
-// Funcao para abertura de um diretorio, a partir do caminho
-// especificado em path, no disco indicado por d, no modo Read/Write,
-// criando o diretorio se nao existir. Retorna um descritor de arquivo,
-// em caso de sucesso. Retorna -1, caso contrario.
-int myFSOpenDir(Disk *d, const char *path)
+// Le ate maxEntries entradas de um diretorio aberto a partir do cursor,
+// que avanca, apenas as que comecam por prefix se nao for NULL. Com arvore
+// de nomes, as entradas vem em ordem de nome, e a leitura por prefixo vai
+// direto a elas; sem arvore, na ordem do diretorio, um trecho de cada vez
+// direto do bloco em cache, sem carregar o diretorio. Retorna o numero de
+// entradas lidas, 0 no fim do diretorio ou -1 em caso de falha
+int readDirEntries(FileDescriptor *openFile, const char *prefix, FSDirent *entries, unsigned int maxEntries)
 {
-	// skip
-	return -1;
+	// sem arvore, o cursor de um diretorio e' a posicao a partir da qual a
+	// proxima entrada e' procurada; com arvore, o ultimo nome lido marca a
+	// posicao, e uma leitura ja iniciada na ordem do diretorio, antes de a
+	// arvore existir, continua nessa ordem
+	Inode *inode = openFile->file->inode;
+	DirHeader header;
+	if (readDirHeader(inode, &header) == -1)
+		return -1;
+	if (header.indexInode != 0 && (openFile->cursor == 0 || openFile->dirName != NULL))
+	{
+		Inode *tree = inodeLoad(header.indexInode, openFile->file->disk);
+		if (tree == NULL)
+			return -1;
+		int ret = 0;
+		if (inodeGetFileType(tree) == FILETYPE_DIRTREE)
+			ret = readDirTreeEntries(openFile, tree, prefix, entries, maxEntries);
+		free(tree);
+		if (ret != 0 || openFile->dirName != NULL)
+			return ret;
+	}
+	unsigned int prefixLength = prefix != NULL ? strlen(prefix) : 0;
+	unsigned int size = inodeGetFileSize(inode);
+	unsigned int count = 0;
+	while (count < maxEntries && openFile->cursor < size)
+	{
+		unsigned int cursor = openFile->cursor;
+		if (header.format == DIR_FORMAT_FIXED)
+		{
+			int ret = readNextDirEntry(inode, &header, &cursor, &entries[count].inumber, entries[count].name);
+			if (ret == -1)
+				return -1;
+			if (ret == 0)
+				break;
+			openFile->cursor = cursor + 1;
+			if (prefix == NULL || strncmp(entries[count].name, prefix, prefixLength) == 0)
+				count++;
+			continue;
+		}
+		unsigned int chunkOffset = cursor - cursor % DIR_CHUNK_SIZE;
+		unsigned int blockAddr, inodeNumber, length, nameLength;
+		unsigned char *chunk = pinDirChunk(inode, chunkOffset, &blockAddr);
+		if (chunk == NULL)
+			return -1;
+		unsigned int pos = dirChunkStart(chunkOffset);
+		for (; pos < DIR_CHUNK_SIZE && count < maxEntries; pos += length)
+		{
+			if (decodeDirRecord(chunk, pos, &inodeNumber, &length, &nameLength) == -1)
+			{
+				cacheUnpin(blockAddr, 0);
+				return -1;
+			}
+			if (inodeNumber == 0 || chunkOffset + pos < cursor)
+				continue;
+			openFile->cursor = chunkOffset + pos + 1;
+			if (prefix != NULL &&
+				(nameLength < prefixLength || memcmp(&chunk[pos + DIR_RECORD_HEADER_SIZE], prefix, prefixLength) != 0))
+				continue;
+			entries[count].inumber = inodeNumber;
+			memcpy(entries[count].name, &chunk[pos + DIR_RECORD_HEADER_SIZE], nameLength);
+			entries[count].name[nameLength] = '\0';
+			count++;
+		}
+		cacheUnpin(blockAddr, 0);
+		if (pos >= DIR_CHUNK_SIZE)
+			openFile->cursor = chunkOffset + DIR_CHUNK_SIZE;
+	}
+	return count;
 }
 
 // Funcao para a leitura de um diretorio, identificado por um descritor
@@ -794,8 +4034,45 @@ int myFSOpenDir(Disk *d, const char *path)
 // mal sucedido
 int myFSReadDir(int fd, char *filename, unsigned int *inumber)
 {
-	// skip
-	return -1;
+	FileDescriptor *openFile = getDirDescriptor(fd);
+	if (openFile == NULL)
+		return -1;
+	FSDirent entry;
+	int ret = readDirEntries(openFile, NULL, &entry, 1);
+	if (ret == 1)
+	{
+		strcpy(filename, entry.name);
+		*inumber = entry.inumber;
+	}
+	return ret;
+}
+
+// Funcao para a leitura de ate maxEntries entradas de um diretorio,
+// identificado por um descritor de arquivo existente, a partir da posicao
+// atual do cursor no diretorio, que avanca. As entradas sao copiadas para
+// entries. Retorna o numero de entradas lidas, 0 se fim de diretorio ou -1
+// caso mal sucedido
+int myFSGetdents(int fd, FSDirent *entries, unsigned int maxEntries)
+{
+	FileDescriptor *openFile = getDirDescriptor(fd);
+	if (openFile == NULL || entries == NULL)
+		return -1;
+	return readDirEntries(openFile, NULL, entries, maxEntries);
+}
+
+// Funcao para a leitura de ate maxEntries entradas de um diretorio,
+// identificado por um descritor de arquivo existente, cujos nomes comecam
+// por prefix, a partir da posicao atual do cursor no diretorio, que avanca.
+// Em diretorios grandes, indexados pela arvore de nomes, as entradas vem em
+// ordem de nome e apenas as do prefixo sao lidas. Retorna o numero de
+// entradas lidas, 0 se nao houver mais entradas com o prefixo ou -1 caso
+// mal sucedido
+int myFSGetdentsPrefix(int fd, const char *prefix, FSDirent *entries, unsigned int maxEntries)
+{
+	FileDescriptor *openFile = getDirDescriptor(fd);
+	if (openFile == NULL || prefix == NULL || entries == NULL)
+		return -1;
+	return readDirEntries(openFile, prefix, entries, maxEntries);
 }
 
 // Funcao para adicionar uma entrada a um diretorio, identificado por um
@@ -804,8 +4081,25 @@ int myFSReadDir(int fd, char *filename, unsigned int *inumber)
 // Retorna 0 caso bem sucedido, ou -1 caso contrario.
 int myFSLink(int fd, const char *filename, unsigned int inumber)
 {
-	// skip
-	return -1;
+	FileDescriptor *openFile = getDirDescriptor(fd);
+	if (openFile == NULL)
+		return -1;
+	if (filename == NULL || filename[0] == '\0' || strlen(filename) >= MAX_FILENAME_LENGTH || strchr(filename, '/') != NULL)
+		return -1;
+	if (inumber <= ROOT_INODE_NUMBER || inumber > superblock[SUPERBLOCK_ITEM_NUMINODES])
+		return -1;
+	Disk *d = openFile->file->disk;
+	OpenInode *entry = getOpenInode(d, inumber);
+	if (entry == NULL)
+		return -1;
+	// ligacoes adicionais a diretorios criariam ciclos na arvore
+	int ret = 0;
+	if (inodeGetFileType(entry->inode) != FILETYPE_REGULAR || inodeGetRefCount(entry->inode) == 0 ||
+		addDirectoryEntry(d, openFile->file->inode, entry->inode, filename) == -1)
+		ret = -1;
+	if (putOpenInode(entry) == -1)
+		ret = -1;
+	return ret;
 }
 
 // Funcao para remover uma entrada existente em um diretorio,
@@ -814,16 +4108,145 @@ int myFSLink(int fd, const char *filename, unsigned int inumber)
 // sucedido, ou -1 caso contrario.
 int myFSUnlink(int fd, const char *filename)
 {
-	// skip
-	return -1;
+	FileDescriptor *openFile = getDirDescriptor(fd);
+	if (openFile == NULL)
+		return -1;
+	if (filename == NULL || strcmp(filename, ".") == 0 || strcmp(filename, "..") == 0)
+		return -1;
+	Disk *d = openFile->file->disk;
+	Inode *inodeDir = openFile->file->inode;
+	unsigned int inodeNumber = lookupEntry(d, inodeDir, filename);
+	if (inodeNumber == 0)
+		return -1;
+	OpenInode *entry = getOpenInode(d, inodeNumber);
+	if (entry == NULL)
+		return -1;
+
+	// diretorios so sao removidos vazios, restando apenas "." e ".."
+	int isDir = inodeGetFileType(entry->inode) == FILETYPE_DIR;
+	int ret = 0;
+	if (isDir)
+	{
+		DirHeader header;
+		if (readDirHeader(entry->inode, &header) == -1 || header.numEntries != 2)
+			ret = -1;
+	}
+	if (ret == 0)
+		ret = removeDirectoryEntry(d, inodeDir, filename);
+
+	// um diretorio removido perde tambem sua propria entrada "." e devolve
+	// a referencia de seu ".." ao diretorio pai
+	if (ret == 0)
+	{
+		unsigned int refCount = inodeGetRefCount(entry->inode);
+		refCount = refCount > 0 ? refCount - 1 : 0;
+		if (isDir)
+		{
+			refCount = 0;
+			if (inodeGetRefCount(inodeDir) > 0)
+				inodeSetRefCount(inodeDir, inodeGetRefCount(inodeDir) - 1);
+			ret = inodeSave(inodeDir);
+		}
+		inodeSetRefCount(entry->inode, refCount);
+		if (ret == 0)
+			ret = inodeSave(entry->inode);
+	}
+	// um i-node ainda aberto so e' liberado ao soltar sua ultima referencia
+	if (putOpenInode(entry) == -1)
+		ret = -1;
+	return ret;
+}
+
+// Funcao para criar de uma so vez, em um diretorio identificado por um
+// descritor de arquivo existente, numNames arquivos vazios com os nomes
+// indicados em names. Os i-nodes de todos os arquivos, criados sem blocos,
+// sao alocados juntos, cada setor de i-nodes e' gravado uma unica vez, e as
+// entradas sao acrescentadas aos trechos do diretorio em cache, com um
+// unico cabecalho gravado ao final. Os arquivos nao sao abertos. A criacao
+// para no primeiro nome invalido ou ja existente. Retorna o numero de
+// arquivos criados, ou -1 caso mal sucedido
+int myFSCreateMany(int fd, const char **names, unsigned int numNames)
+{
+	FileDescriptor *openFile = getDirDescriptor(fd);
+	if (openFile == NULL || names == NULL)
+		return -1;
+	unsigned int count = 0;
+	while (count < numNames && names[count] != NULL && names[count][0] != '\0' &&
+		   strlen(names[count]) < MAX_FILENAME_LENGTH && strchr(names[count], '/') == NULL)
+		count++;
+	if (count == 0)
+		return 0;
+	Disk *d = openFile->file->disk;
+	Inode *inodeDir = openFile->file->inode;
+	DirHeader header;
+	Inode *tree;
+	if (openDirectoryForUpdate(d, inodeDir, &header, &tree) == -1)
+		return -1;
+
+	// a arvore de nomes de um diretorio que atingira o limite e' criada
+	// antes de os i-nodes livres serem escolhidos, e recebe os nomes um a um
+	if (tree == NULL && header.numEntries + count >= DIR_INDEX_THRESHOLD && buildDirIndex(d, inodeDir, &header) == 0 &&
+		(tree = inodeLoad(header.indexInode, d)) == NULL)
+	{
+		writeDirHeader(inodeDir, &header);
+		return -1;
+	}
+
+	// os arquivos nascem sem blocos, como em myFSOpen
+	Inode **inodes = malloc(count * sizeof(Inode *));
+	unsigned int numInodes = 0;
+	int ok = inodes != NULL;
+	if (ok && superblock[SUPERBLOCK_ITEM_FREEINODES] < reservedInodes + count)
+		reclaimSpace(d, RECLAIM_ALL);
+	ok = ok && superblock[SUPERBLOCK_ITEM_FREEINODES] >= reservedInodes + count;
+	if (ok)
+	{
+		numInodes = inodeFindFreeInodes(ROOT_INODE_NUMBER + 1, count, inodes, d);
+		ok = numInodes == count;
+		for (unsigned int i = 0; i < numInodes; i++)
+			if (inodeGetNumber(inodes[i]) > superblock[SUPERBLOCK_ITEM_NUMINODES])
+				ok = 0;
+	}
+	unsigned int created = 0;
+	if (ok)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			inodeSetFileType(inodes[i], FILETYPE_REGULAR);
+			inodeSetRefCount(inodes[i], 1);
+		}
+		// gravados antes das entradas, os i-nodes deixam de ser livres e nao
+		// sao escolhidos por extensoes do diretorio que cresce
+		superblock[SUPERBLOCK_ITEM_FREEINODES] -= count;
+		if (inodeSaveMany(inodes, count) == -1 || saveSuperblock(d) == -1)
+			ok = 0;
+		while (ok && created < count &&
+			   insertDirectoryEntry(d, inodeDir, &header, &tree, inodeGetNumber(inodes[created]), names[created]) == 0)
+			created++;
+		// i-nodes sem entrada no diretorio sao liberados
+		for (unsigned int i = created; i < count; i++)
+			releaseInode(d, inodes[i]);
+	}
+	for (unsigned int i = 0; i < numInodes; i++)
+		free(inodes[i]);
+	free(inodes);
+	free(tree);
+	// uma arvore descartada por falha e' reconstruida
+	if (header.numEntries >= DIR_INDEX_THRESHOLD && header.indexInode == 0)
+		buildDirIndex(d, inodeDir, &header);
+	if (writeDirHeader(inodeDir, &header) == -1 || !ok)
+		return -1;
+	return created;
 }
 
 // Funcao para fechar um diretorio, identificado por um descritor de
 // arquivo existente. Retorna 0 caso bem sucedido, ou -1 caso contrario.
 int myFSCloseDir(int fd)
 {
-	// skip
-	return -1;
+	FileDescriptor *openFile = getFileDescriptor(fd);
+	if (openFile == NULL || inodeGetFileType(openFile->file->inode) != FILETYPE_DIR)
+		return -1;
+	return myFSClose(fd);
 }
 
 // Funcao para instalar seu sistema de arquivos no S.O., registrando-o junto
@@ -832,7 +4255,7 @@ int myFSCloseDir(int fd)
 // Caso contrario, retorna -1
 int installMyFS(void)
 {
-	FSInfo *myfs = malloc(sizeof(FSInfo));
+	FSInfo *myfs = calloc(1, sizeof(FSInfo));
 	myfs->fsid = 1;
 	myfs->fsname = "WillianFS";
 	myfs->isidleFn = myFSIsIdle;
@@ -841,10 +4264,35 @@ int installMyFS(void)
 	myfs->readFn = myFSRead;
 	myfs->writeFn = myFSWrite;
 	myfs->closeFn = myFSClose;
+	myfs->preadFn = myFSPread;
+	myfs->pwriteFn = myFSPwrite;
+	myfs->seekFn = myFSSeek;
+	myfs->allocateFn = myFSAllocate;
+	myfs->truncateFn = myFSTruncate;
+	myfs->readvFn = myFSReadv;
+	myfs->writevFn = myFSWritev;
+	myfs->mmapFn = myFSMmap;
+	myfs->mfaultFn = myFSMfault;
+	myfs->msyncFn = myFSMsync;
+	myfs->munmapFn = myFSMunmap;
+	myfs->copyRangeFn = myFSCopyRange;
+	myfs->setappendFn = myFSSetAppend;
+	myfs->pread64Fn = myFSPread64;
+	myfs->pwrite64Fn = myFSPwrite64;
+	myfs->seek64Fn = myFSSeek64;
+	myfs->allocate64Fn = myFSAllocate64;
+	myfs->truncate64Fn = myFSTruncate64;
+	myfs->copyRange64Fn = myFSCopyRange64;
+	myfs->mmap64Fn = myFSMmap64;
+	myfs->statfsFn = myFSStatfs;
+	myfs->syncFn = myFSSync;
 	myfs->opendirFn = myFSOpenDir;
 	myfs->readdirFn = myFSReadDir;
+	myfs->getdentsFn = myFSGetdents;
+	myfs->getdentsPrefixFn = myFSGetdentsPrefix;
 	myfs->linkFn = myFSLink;
 	myfs->unlinkFn = myFSUnlink;
+	myfs->createManyFn = myFSCreateMany;
 	myfs->closedirFn = myFSCloseDir;
 
 	return vfsRegisterFS(myfs);
@@ -6,7 +6,7 @@
 *  Organizacao: Universidade Federal de Juiz de Fora
 *  Departamento: Dep. Ciencia da Computacao
 *
-*  => NAO MODIFIQUE ESTE ARQUIVO <=
+*  Fornecido com o enunciado; estendido e mantido junto com o MyFS
 *
 */
 
@@ -52,11 +52,13 @@ int vfsMountRoot (Disk *d, char fsId) {
 }
 
 //Funcao para a desmontagem do sistema de arquivos. Nao podem haver arquivos
-//ou diretorios abertos para a desmontagem. Retorna 0 caso bem sucedido e -1
+//ou diretorios abertos para a desmontagem. Dados mantidos em memoria sao
+//gravados em disco antes da desmontagem. Retorna 0 caso bem sucedido e -1
 //caso contrario
 int vfsUnmountRoot ( void ) {
 	if ( !rootDisk || !rootFS ) return -1;
 	if ( !rootFS->isidleFn (rootDisk) ) return -1;
+	if ( rootFS->syncFn && rootFS->syncFn (rootDisk) == -1 ) return -1;
 	rootFS = NULL;
 	rootDisk = NULL;
 	return 0;
@@ -84,8 +86,9 @@ int vfsOpen (const char *path) {
 }
 
 //Funcao para a leitura de um arquivo, a partir de um descritor de arquivo
-//existente. Os dados lidos sao copiados para buf e terao tamanho maximo de
-//nbytes. Retorna o numero de bytes efetivamente lidos em caso de sucesso ou
+//existente. Os dados lidos, a partir da posicao do cursor, sao copiados para
+//buf e terao tamanho maximo de nbytes; o cursor avanca o numero de bytes
+//lidos. Retorna o numero de bytes efetivamente lidos em caso de sucesso ou
 //-1, caso contrario.
 int vfsRead (int fd, char *buf, unsigned int nbytes) {
 	if ( !rootDisk || !rootFS ) return -1;
@@ -108,6 +111,196 @@ int vfsClose (int fd) {
         return rootFS->closeFn (fd);
 }
 
+//Funcao para a leitura de um arquivo a partir da posicao offset, sem uso nem
+//alteracao do cursor do descritor de arquivo. Os dados lidos sao copiados
+//para buf e terao tamanho maximo de nbytes. Retorna o numero de bytes
+//efetivamente lidos em caso de sucesso ou -1, caso contrario.
+int vfsPread (int fd, char *buf, unsigned int nbytes, unsigned int offset) {
+        if ( !rootDisk || !rootFS || !rootFS->preadFn ) return -1;
+        return rootFS->preadFn (fd, buf, nbytes, offset);
+}
+
+//Funcao para a escrita de um arquivo a partir da posicao offset, sem uso nem
+//alteracao do cursor do descritor de arquivo. Retorna o numero de bytes
+//efetivamente escritos em caso de sucesso ou -1, caso contrario
+int vfsPwrite (int fd, const char *buf, unsigned int nbytes,
+               unsigned int offset) {
+        if ( !rootDisk || !rootFS || !rootFS->pwriteFn ) return -1;
+        return rootFS->pwriteFn (fd, buf, nbytes, offset);
+}
+
+//Funcao para posicionar o cursor de um arquivo aberto na posicao offset,
+//usada pelas proximas chamadas de vfsRead e vfsWrite. Retorna a nova posicao
+//do cursor em caso de sucesso ou -1, caso contrario
+int vfsSeek (int fd, unsigned int offset) {
+        if ( !rootDisk || !rootFS || !rootFS->seekFn ) return -1;
+        return rootFS->seekFn (fd, offset);
+}
+
+//Funcao para pre-alocacao de espaco de um arquivo, a partir de um descritor
+//de arquivo existente. Garante que os bytes de offset ate offset+nbytes
+//possuam blocos em disco, contiguos sempre que possivel, sem alterar o
+//tamanho do arquivo. Retorna 0 caso bem sucedido, ou -1 caso contrario
+int vfsAllocate (int fd, unsigned int offset, unsigned int nbytes) {
+        if ( !rootDisk || !rootFS || !rootFS->allocateFn ) return -1;
+        return rootFS->allocateFn (fd, offset, nbytes);
+}
+
+//Funcao para alterar o tamanho de um arquivo aberto para size bytes. Se o
+//arquivo crescer, o trecho novo e' lido como zeros; se diminuir, os blocos
+//alem do novo fim sao liberados. Retorna 0 caso bem sucedido, ou -1 caso
+//contrario
+int vfsTruncate (int fd, unsigned int size) {
+        if ( !rootDisk || !rootFS || !rootFS->truncateFn ) return -1;
+        return rootFS->truncateFn (fd, size);
+}
+
+//Funcao para a leitura vetorizada de um arquivo, a partir de um descritor de
+//arquivo existente. Os dados lidos, a partir da posicao do cursor, preenchem
+//em ordem os iovcnt trechos de iov. Retorna o numero de bytes efetivamente
+//lidos em caso de sucesso ou -1, caso contrario.
+int vfsReadv (int fd, const FSIOVec *iov, unsigned int iovcnt) {
+        if ( !rootDisk || !rootFS || !rootFS->readvFn ) return -1;
+        return rootFS->readvFn (fd, iov, iovcnt);
+}
+
+//Funcao para a escrita vetorizada de um arquivo, a partir de um descritor de
+//arquivo existente. Os iovcnt trechos de iov sao gravados em ordem a partir
+//da posicao do cursor. Retorna o numero de bytes efetivamente escritos em
+//caso de sucesso ou -1, caso contrario
+int vfsWritev (int fd, const FSIOVec *iov, unsigned int iovcnt) {
+        if ( !rootDisk || !rootFS || !rootFS->writevFn ) return -1;
+        return rootFS->writevFn (fd, iov, iovcnt);
+}
+
+//Funcao para mapear em memoria length bytes de um arquivo aberto, a partir
+//de offset (multiplo do tamanho do bloco). Antes de acessar um trecho do
+//mapeamento, suas paginas devem ser carregadas com vfsMfault. Retorna o
+//endereco do mapeamento em caso de sucesso ou NULL, caso contrario
+char* vfsMmap (int fd, unsigned int offset, unsigned int length) {
+        if ( !rootDisk || !rootFS || !rootFS->mmapFn ) return NULL;
+        return rootFS->mmapFn (fd, offset, length);
+}
+
+//Funcao para carregar as paginas de um mapeamento que contem os nbytes a
+//partir de addr. Se write for diferente de 0, as paginas sao marcadas como
+//modificadas. Retorna 0 caso bem sucedido, ou -1 caso contrario
+int vfsMfault (char *addr, unsigned int nbytes, int write) {
+        if ( !rootDisk || !rootFS || !rootFS->mfaultFn ) return -1;
+        return rootFS->mfaultFn (addr, nbytes, write);
+}
+
+//Funcao para gravar no arquivo as paginas modificadas de um mapeamento que
+//contem os nbytes a partir de addr. Retorna 0 caso bem sucedido, ou -1 caso
+//contrario
+int vfsMsync (char *addr, unsigned int nbytes) {
+        if ( !rootDisk || !rootFS || !rootFS->msyncFn ) return -1;
+        return rootFS->msyncFn (addr, nbytes);
+}
+
+//Funcao para desfazer o mapeamento iniciado em addr, gravando antes as
+//paginas modificadas. Retorna 0 caso bem sucedido, ou -1 caso contrario
+int vfsMunmap (char *addr) {
+        if ( !rootDisk || !rootFS || !rootFS->munmapFn ) return -1;
+        return rootFS->munmapFn (addr);
+}
+
+//Funcao para copiar nbytes do arquivo fdIn, a partir de offsetIn, para o
+//arquivo fdOut, a partir de offsetOut, sem passar os dados por buffers do
+//chamador. Os cursores nao sao alterados. Retorna o numero de bytes copiados
+//em caso de sucesso (0 se offsetIn estiver no fim da origem) ou -1, caso
+//contrario
+int vfsCopyRange (int fdIn, unsigned int offsetIn, int fdOut,
+                  unsigned int offsetOut, unsigned int nbytes) {
+        if ( !rootDisk || !rootFS || !rootFS->copyRangeFn ) return -1;
+        return rootFS->copyRangeFn (fdIn, offsetIn, fdOut, offsetOut, nbytes);
+}
+
+//Funcao para ligar (append diferente de 0) ou desligar o modo de acrescimo
+//de um arquivo aberto. Nesse modo, vfsWrite e vfsWritev sempre escrevem no
+//fim do arquivo, como em um log. Retorna 0 caso bem sucedido, ou -1 caso
+//contrario
+int vfsSetAppend (int fd, int append) {
+        if ( !rootDisk || !rootFS || !rootFS->setappendFn ) return -1;
+        return rootFS->setappendFn (fd, append);
+}
+
+//Funcao para a leitura de um arquivo a partir da posicao offset, de 64 bits,
+//sem uso nem alteracao do cursor do descritor de arquivo. Retorna o numero de
+//bytes efetivamente lidos em caso de sucesso ou -1, caso contrario.
+int vfsPread64 (int fd, char *buf, unsigned int nbytes,
+                unsigned long long offset) {
+        if ( !rootDisk || !rootFS || !rootFS->pread64Fn ) return -1;
+        return rootFS->pread64Fn (fd, buf, nbytes, offset);
+}
+
+//Funcao para a escrita de um arquivo a partir da posicao offset, de 64 bits,
+//sem uso nem alteracao do cursor do descritor de arquivo. Retorna o numero de
+//bytes efetivamente escritos em caso de sucesso ou -1, caso contrario
+int vfsPwrite64 (int fd, const char *buf, unsigned int nbytes,
+                 unsigned long long offset) {
+        if ( !rootDisk || !rootFS || !rootFS->pwrite64Fn ) return -1;
+        return rootFS->pwrite64Fn (fd, buf, nbytes, offset);
+}
+
+//Funcao para posicionar o cursor de um arquivo aberto na posicao offset, de
+//64 bits. Retorna a nova posicao do cursor em caso de sucesso ou -1, caso
+//contrario
+long long vfsSeek64 (int fd, unsigned long long offset) {
+        if ( !rootDisk || !rootFS || !rootFS->seek64Fn ) return -1;
+        return rootFS->seek64Fn (fd, offset);
+}
+
+//Funcao para pre-alocacao de espaco de um arquivo, como vfsAllocate, com
+//offset e nbytes de 64 bits. Retorna 0 caso bem sucedido, ou -1 caso
+//contrario
+int vfsAllocate64 (int fd, unsigned long long offset,
+                   unsigned long long nbytes) {
+        if ( !rootDisk || !rootFS || !rootFS->allocate64Fn ) return -1;
+        return rootFS->allocate64Fn (fd, offset, nbytes);
+}
+
+//Funcao para alterar o tamanho de um arquivo aberto para size bytes, como
+//vfsTruncate, com tamanho de 64 bits. Retorna 0 caso bem sucedido, ou -1 caso
+//contrario
+int vfsTruncate64 (int fd, unsigned long long size) {
+        if ( !rootDisk || !rootFS || !rootFS->truncate64Fn ) return -1;
+        return rootFS->truncate64Fn (fd, size);
+}
+
+//Funcao para copiar nbytes entre arquivos abertos, como vfsCopyRange, com
+//posicoes de 64 bits. Retorna o numero de bytes copiados em caso de sucesso
+//ou -1, caso contrario
+int vfsCopyRange64 (int fdIn, unsigned long long offsetIn, int fdOut,
+                    unsigned long long offsetOut, unsigned int nbytes) {
+        if ( !rootDisk || !rootFS || !rootFS->copyRange64Fn ) return -1;
+        return rootFS->copyRange64Fn (fdIn, offsetIn, fdOut, offsetOut, nbytes);
+}
+
+//Funcao para mapear em memoria length bytes de um arquivo aberto, como
+//vfsMmap, a partir da posicao offset, de 64 bits. Retorna o endereco do
+//mapeamento em caso de sucesso ou NULL, caso contrario
+char* vfsMmap64 (int fd, unsigned long long offset, unsigned int length) {
+        if ( !rootDisk || !rootFS || !rootFS->mmap64Fn ) return NULL;
+        return rootFS->mmap64Fn (fd, offset, length);
+}
+
+//Funcao para obtencao de informacoes de ocupacao (blocos e i-nodes livres)
+//do sistema de arquivos raiz, copiadas para st. Retorna 0 caso bem sucedido,
+//ou -1 caso contrario
+int vfsStatfs (FSStat *st) {
+        if ( !rootDisk || !rootFS || !rootFS->statfsFn ) return -1;
+        return rootFS->statfsFn (rootDisk, st);
+}
+
+//Funcao para sincronizacao do sistema de arquivos raiz, gravando em disco
+//todos os dados e metadados mantidos em memoria. Retorna 0 caso bem
+//sucedido, ou -1 caso contrario
+int vfsSync (void) {
+        if ( !rootDisk || !rootFS || !rootFS->syncFn ) return -1;
+        return rootFS->syncFn (rootDisk);
+}
+
 //Funcao para abertura de um diretorio, a partir do caminho especificado em
 //path, no modo Read/Write, criando o diretorio se nao existir. Retorna um
 //descritor de arquivo, em caso de sucesso. Retorna -1, caso contrario.
@@ -127,6 +320,26 @@ int vfsReaddir (int fd, char *filename, unsigned int *inumber) {
         return rootFS->readdirFn (fd, filename, inumber);
 }
 
+//Funcao para a leitura de ate maxEntries entradas de um diretorio,
+//identificado por um descritor de arquivo existente, a partir da posicao
+//atual do cursor no diretorio, que avanca. As entradas sao copiadas para
+//entries. Retorna o numero de entradas lidas, 0 se fim do diretorio ou -1
+//caso mal sucedido.
+int vfsGetdents (int fd, FSDirent *entries, unsigned int maxEntries) {
+        if ( !rootDisk || !rootFS || !rootFS->getdentsFn ) return -1;
+        return rootFS->getdentsFn (fd, entries, maxEntries);
+}
+
+//Funcao para a leitura de ate maxEntries entradas de um diretorio,
+//identificado por um descritor de arquivo existente, cujos nomes comecam por
+//prefix, a partir da posicao atual do cursor no diretorio, que avanca.
+//Retorna o numero de entradas lidas, 0 se nao houver mais entradas com o
+//prefixo ou -1 caso mal sucedido.
+int vfsGetdentsPrefix (int fd, const char *prefix, FSDirent *entries, unsigned int maxEntries) {
+        if ( !rootDisk || !rootFS || !rootFS->getdentsPrefixFn ) return -1;
+        return rootFS->getdentsPrefixFn (fd, prefix, entries, maxEntries);
+}
+
 //Funcao para adicionar uma entrada a um diretorio, identificado por um 
 //descritor de arquivo existente. A nova entrada tera' o nome indicado por
 //filename e apontara' para o numero de i-node indicado por inumber. Retorna 0\
@@ -144,6 +357,16 @@ int vfsUnlink (int fd, const char *filename) {
         return rootFS->unlinkFn (fd, filename);
 }
 
+//Funcao para criar de uma so vez, em um diretorio identificado por um
+//descritor de arquivo existente, numNames arquivos vazios com os nomes
+//indicados em names. Os arquivos nao sao abertos, e a criacao para no
+//primeiro nome invalido ou ja existente. Retorna o numero de arquivos
+//criados, ou -1 caso mal sucedido.
+int vfsCreateMany (int fd, const char **names, unsigned int numNames) {
+        if ( !rootDisk || !rootFS || !rootFS->createManyFn ) return -1;
+        return rootFS->createManyFn (fd, names, numNames);
+}
+
 //Funcao para fechar um diretorio, identificado por um descritor de arquivo
 //existente. Retorna 0 caso bem sucedido, ou -1 caso contrario.
 int vfsClosedir (int fd) {
@@ -6,7 +6,7 @@
 *  Organizacao: Universidade Federal de Juiz de Fora
 *  Departamento: Dep. Ciencia da Computacao
 *
-*  => NAO MODIFIQUE ESTE ARQUIVO <=
+*  Fornecido com o enunciado; estendido e mantido junto com o MyFS
 *
 */
 
@@ -21,6 +21,30 @@
 #define FILETYPE_DIR 128    //Identificador de tipo de arquivo: diretorio
 #define FILETYPE_REGULAR 64 //Identificador de tipo de arquivo: arq regular
 
+//Estrutura com informacoes de ocupacao de um sistema de arquivos, preenchida
+//pela funcao vfsStatfs()
+typedef struct fs_stat {
+	unsigned int blockSize;     // Tamanho do bloco, em bytes
+	unsigned int numBlocks;     // Numero total de blocos
+	unsigned int numFreeBlocks; // Numero de blocos disponiveis
+	unsigned int numInodes;     // Numero total de i-nodes
+	unsigned int numFreeInodes; // Numero de i-nodes livres
+} FSStat;
+
+//Estrutura que descreve um trecho de memoria usado nas funcoes de leitura e
+//escrita vetorizadas (vfsReadv e vfsWritev)
+typedef struct fs_iovec {
+	char *base;       // Inicio do trecho
+	unsigned int len; // Tamanho do trecho, em bytes
+} FSIOVec;
+
+//Estrutura que descreve uma entrada de diretorio, preenchida pela funcao de
+//leitura de varias entradas de uma vez (vfsGetdents)
+typedef struct fs_dirent {
+	unsigned int inumber;              // Numero do i-node da entrada
+	char name[MAX_FILENAME_LENGTH+1]; // Nome da entrada, terminado em \0
+} FSDirent;
+
 //Estrutura para definicao da API de sistemas de arquivos.
 //Deve ser preenchida com os ponteiros das respectivas funcoes e passada
 //para registro por meio da funcao vfsRegister()
@@ -61,6 +85,111 @@ typedef struct fs_info {
 	//existente. Retorna 0 caso bem sucedido, ou -1 caso contrario
 	int (*closeFn) (int fd);
 
+	//Funcao para a leitura de um arquivo a partir da posicao offset, sem
+	//uso nem alteracao do cursor do descritor de arquivo. Retorna o numero
+	//de bytes efetivamente lidos em caso de sucesso ou -1, caso contrario.
+	int (*preadFn) (int fd, char *buf, unsigned int nbytes, unsigned int offset);
+
+	//Funcao para a escrita de um arquivo a partir da posicao offset, sem
+	//uso nem alteracao do cursor do descritor de arquivo. Retorna o numero
+	//de bytes efetivamente escritos em caso de sucesso ou -1, caso contrario
+	int (*pwriteFn) (int fd, const char *buf, unsigned int nbytes,
+	                 unsigned int offset);
+
+	//Funcao para posicionar o cursor de um arquivo aberto na posicao
+	//offset, que pode ultrapassar o fim do arquivo; o trecho nao escrito
+	//e' lido como zeros. Retorna a nova posicao do cursor em caso de
+	//sucesso ou -1, caso contrario
+	int (*seekFn) (int fd, unsigned int offset);
+
+	//Funcao para pre-alocacao de espaco de um arquivo, a partir de um
+	//descritor de arquivo existente. Garante que os bytes de offset ate
+	//offset+nbytes possuam blocos em disco, sem alterar o tamanho do
+	//arquivo. Retorna 0 caso bem sucedido, ou -1 caso contrario
+	int (*allocateFn) (int fd, unsigned int offset, unsigned int nbytes);
+
+	//Funcao para a leitura vetorizada de um arquivo, a partir de um
+	//descritor de arquivo existente. Os dados lidos, a partir da posicao do
+	//cursor, preenchem em ordem os iovcnt trechos de iov; o cursor avanca o
+	//numero de bytes lidos. Retorna o numero de bytes efetivamente lidos em
+	//caso de sucesso ou -1, caso contrario.
+	int (*readvFn) (int fd, const FSIOVec *iov, unsigned int iovcnt);
+
+	//Funcao para a escrita vetorizada de um arquivo, a partir de um
+	//descritor de arquivo existente. Os iovcnt trechos de iov sao gravados
+	//em ordem, de forma contigua, a partir da posicao do cursor, que avanca
+	//o numero de bytes escritos. Retorna o numero de bytes efetivamente
+	//escritos em caso de sucesso ou -1, caso contrario
+	int (*writevFn) (int fd, const FSIOVec *iov, unsigned int iovcnt);
+
+	//Funcao para mapear em memoria length bytes de um arquivo aberto, a
+	//partir de offset (multiplo do tamanho do bloco). O conteudo so e'
+	//trazido do disco sob demanda, por mfaultFn. O mapeamento continua
+	//valido apos o fechamento do descritor, ate munmapFn. Retorna o
+	//endereco do mapeamento em caso de sucesso ou NULL, caso contrario
+	char* (*mmapFn) (int fd, unsigned int offset, unsigned int length);
+
+	//Funcao para carregar as paginas de um mapeamento que contem os nbytes
+	//a partir de addr, antes de acessa-los. Se write for diferente de 0, as
+	//paginas sao marcadas como modificadas. Retorna 0 caso bem sucedido, ou
+	//-1 caso contrario
+	int (*mfaultFn) (char *addr, unsigned int nbytes, int write);
+
+	//Funcao para gravar no arquivo as paginas modificadas de um mapeamento
+	//que contem os nbytes a partir de addr. Paginas modificadas tambem sao
+	//gravadas no fechamento do arquivo e em munmapFn. Retorna 0 caso bem
+	//sucedido, ou -1 caso contrario
+	int (*msyncFn) (char *addr, unsigned int nbytes);
+
+	//Funcao para desfazer o mapeamento iniciado em addr, gravando antes as
+	//paginas modificadas. Retorna 0 caso bem sucedido, ou -1 caso contrario
+	int (*munmapFn) (char *addr);
+
+	//Funcao para copiar nbytes do arquivo aberto fdIn, a partir de offsetIn,
+	//para o arquivo aberto fdOut, a partir de offsetOut, dentro do proprio
+	//sistema de arquivos. Os cursores nao sao alterados. Retorna o numero de
+	//bytes copiados em caso de sucesso ou -1, caso contrario
+	int (*copyRangeFn) (int fdIn, unsigned int offsetIn, int fdOut,
+	                    unsigned int offsetOut, unsigned int nbytes);
+
+	//Funcao para ligar (append diferente de 0) ou desligar o modo de
+	//acrescimo de um arquivo aberto, no qual writeFn e writevFn sempre
+	//escrevem no fim do arquivo. Retorna 0 caso bem sucedido, ou -1 caso
+	//contrario
+	int (*setappendFn) (int fd, int append);
+
+	//Funcao para alterar o tamanho de um arquivo aberto para size bytes.
+	//Se o arquivo crescer, o trecho novo e' lido como zeros; se diminuir,
+	//os blocos alem do novo fim sao liberados. Retorna 0 caso bem
+	//sucedido, ou -1 caso contrario
+	int (*truncateFn) (int fd, unsigned int size);
+
+	//Variantes de preadFn, pwriteFn, seekFn, allocateFn, truncateFn,
+	//copyRangeFn e mmapFn com posicoes e tamanhos de arquivo de 64 bits,
+	//para arquivos maiores que 4 GiB. seek64Fn retorna a nova posicao do
+	//cursor ou -1. Os demais retornos sao os das funcoes de 32 bits
+	int (*pread64Fn) (int fd, char *buf, unsigned int nbytes,
+	                  unsigned long long offset);
+	int (*pwrite64Fn) (int fd, const char *buf, unsigned int nbytes,
+	                   unsigned long long offset);
+	long long (*seek64Fn) (int fd, unsigned long long offset);
+	int (*allocate64Fn) (int fd, unsigned long long offset,
+	                     unsigned long long nbytes);
+	int (*truncate64Fn) (int fd, unsigned long long size);
+	int (*copyRange64Fn) (int fdIn, unsigned long long offsetIn, int fdOut,
+	                      unsigned long long offsetOut, unsigned int nbytes);
+	char* (*mmap64Fn) (int fd, unsigned long long offset, unsigned int length);
+
+	//Funcao para obtencao de informacoes de ocupacao do sistema de arquivos
+	//presente no disco d, copiadas para st. Retorna 0 caso bem sucedido, ou
+	//-1 caso contrario
+	int (*statfsFn) (Disk *d, FSStat *st);
+
+	//Funcao para sincronizacao do sistema de arquivos presente no disco d,
+	//gravando em disco todos os dados e metadados mantidos em memoria.
+	//Retorna 0 caso bem sucedido, ou -1 caso contrario
+	int (*syncFn) (Disk *d);
+
 	//Funcao para abertura de um diretorio, a partir do caminho
 	//especificado em path, no disco indicado por d, no modo Read/Write,
 	//criando o diretorio se nao existir. Retorna um descritor de arquivo,
@@ -76,6 +205,20 @@ typedef struct fs_info {
 	//mal sucedido.
 	int (*readdirFn) (int fd, char *filename, unsigned int *inumber);
 
+	//Funcao para a leitura de ate maxEntries entradas de um diretorio,
+	//identificado por um descritor de arquivo existente, a partir da
+	//posicao atual do cursor no diretorio, que avanca. As entradas sao
+	//copiadas para entries. Retorna o numero de entradas lidas, 0 se fim
+	//do diretorio ou -1 caso mal sucedido.
+	int (*getdentsFn) (int fd, FSDirent *entries, unsigned int maxEntries);
+
+	//Funcao para a leitura de ate maxEntries entradas de um diretorio,
+	//identificado por um descritor de arquivo existente, cujos nomes
+	//comecam por prefix, a partir da posicao atual do cursor no diretorio,
+	//que avanca. Retorna o numero de entradas lidas, 0 se nao houver mais
+	//entradas com o prefixo ou -1 caso mal sucedido.
+	int (*getdentsPrefixFn) (int fd, const char *prefix, FSDirent *entries, unsigned int maxEntries);
+
 	//Funcao para adicionar uma entrada a um diretorio, identificado por um
 	//descritor de arquivo existente. A nova entrada tera' o nome indicado
 	//por filename e apontara' para o numero de i-node indicado por inumber.
@@ -88,6 +231,13 @@ typedef struct fs_info {
 	//sucedido, ou -1 caso contrario.
 	int (*unlinkFn) (int fd, const char *filename);
 
+	//Funcao para criar de uma so vez, em um diretorio identificado por um
+	//descritor de arquivo existente, numNames arquivos vazios com os nomes
+	//indicados em names. Os arquivos nao sao abertos, e a criacao para no
+	//primeiro nome invalido ou ja existente. Retorna o numero de arquivos
+	//criados, ou -1 caso mal sucedido.
+	int (*createManyFn) (int fd, const char **names, unsigned int numNames);
+
 	//Funcao para fechar um diretorio, identificado por um descritor de
 	//arquivo existente. Retorna 0 caso bem sucedido, ou -1 caso contrario.	
 	int (*closedirFn) (int fd);
@@ -102,7 +252,8 @@ void vfsInit ( void );
 int vfsMountRoot (Disk *d, char fsId);
 
 //Funcao para a desmontagem do sistema de arquivos. Nao podem haver arquivos
-//ou diretorios abertos para a desmontagem. Retorna 0 caso bem sucedido e -1 
+//ou diretorios abertos para a desmontagem. Dados mantidos em memoria sao
+//gravados em disco antes da desmontagem. Retorna 0 caso bem sucedido e -1 
 //caso contrario
 int vfsUnmountRoot ( void );
 
@@ -118,8 +269,9 @@ int vfsFormat (Disk *d, unsigned int blockSize, char fsId);
 int vfsOpen (const char *path);
 
 //Funcao para a leitura de um arquivo, a partir de um descritor de arquivo
-//existente. Os dados lidos sao copiados para buf e terao tamanho maximo de
-//nbytes. Retorna o numero de bytes efetivamente lidos em caso de sucesso ou
+//existente. Os dados lidos, a partir da posicao do cursor, sao copiados para
+//buf e terao tamanho maximo de nbytes; o cursor avanca o numero de bytes
+//lidos. Retorna o numero de bytes efetivamente lidos em caso de sucesso ou
 //-1, caso contrario.
 int vfsRead (int fd, char *buf, unsigned int nbytes);
 
@@ -133,6 +285,130 @@ int vfsWrite (int fd, const char *buf, unsigned int nbytes);
 //Retorna 0 caso bem sucedido, ou -1 caso contrario
 int vfsClose (int fd);
 
+//Funcao para a leitura de um arquivo a partir da posicao offset, sem uso nem
+//alteracao do cursor do descritor de arquivo. Os dados lidos sao copiados
+//para buf e terao tamanho maximo de nbytes. Retorna o numero de bytes
+//efetivamente lidos em caso de sucesso ou -1, caso contrario.
+int vfsPread (int fd, char *buf, unsigned int nbytes, unsigned int offset);
+
+//Funcao para a escrita de um arquivo a partir da posicao offset, sem uso nem
+//alteracao do cursor do descritor de arquivo. Retorna o numero de bytes
+//efetivamente escritos em caso de sucesso ou -1, caso contrario
+int vfsPwrite (int fd, const char *buf, unsigned int nbytes,
+               unsigned int offset);
+
+//Funcao para posicionar o cursor de um arquivo aberto na posicao offset,
+//usada pelas proximas chamadas de vfsRead e vfsWrite. Retorna a nova posicao
+//do cursor em caso de sucesso ou -1, caso contrario
+int vfsSeek (int fd, unsigned int offset);
+
+//Funcao para pre-alocacao de espaco de um arquivo, a partir de um descritor
+//de arquivo existente. Garante que os bytes de offset ate offset+nbytes
+//possuam blocos em disco, contiguos sempre que possivel, sem alterar o
+//tamanho do arquivo. Retorna 0 caso bem sucedido, ou -1 caso contrario
+int vfsAllocate (int fd, unsigned int offset, unsigned int nbytes);
+
+//Funcao para alterar o tamanho de um arquivo aberto para size bytes. Se o
+//arquivo crescer, o trecho novo e' lido como zeros; se diminuir, os blocos
+//alem do novo fim sao liberados. Retorna 0 caso bem sucedido, ou -1 caso
+//contrario
+int vfsTruncate (int fd, unsigned int size);
+
+//Funcao para a leitura vetorizada de um arquivo, a partir de um descritor de
+//arquivo existente. Os dados lidos, a partir da posicao do cursor, preenchem
+//em ordem os iovcnt trechos de iov. Retorna o numero de bytes efetivamente
+//lidos em caso de sucesso ou -1, caso contrario.
+int vfsReadv (int fd, const FSIOVec *iov, unsigned int iovcnt);
+
+//Funcao para a escrita vetorizada de um arquivo, a partir de um descritor de
+//arquivo existente. Os iovcnt trechos de iov sao gravados em ordem a partir
+//da posicao do cursor. Retorna o numero de bytes efetivamente escritos em
+//caso de sucesso ou -1, caso contrario
+int vfsWritev (int fd, const FSIOVec *iov, unsigned int iovcnt);
+
+//Funcao para mapear em memoria length bytes de um arquivo aberto, a partir
+//de offset (multiplo do tamanho do bloco). Antes de acessar um trecho do
+//mapeamento, suas paginas devem ser carregadas com vfsMfault. Retorna o
+//endereco do mapeamento em caso de sucesso ou NULL, caso contrario
+char* vfsMmap (int fd, unsigned int offset, unsigned int length);
+
+//Funcao para carregar as paginas de um mapeamento que contem os nbytes a
+//partir de addr. Se write for diferente de 0, as paginas sao marcadas como
+//modificadas. Retorna 0 caso bem sucedido, ou -1 caso contrario
+int vfsMfault (char *addr, unsigned int nbytes, int write);
+
+//Funcao para gravar no arquivo as paginas modificadas de um mapeamento que
+//contem os nbytes a partir de addr. Retorna 0 caso bem sucedido, ou -1 caso
+//contrario
+int vfsMsync (char *addr, unsigned int nbytes);
+
+//Funcao para desfazer o mapeamento iniciado em addr, gravando antes as
+//paginas modificadas. Retorna 0 caso bem sucedido, ou -1 caso contrario
+int vfsMunmap (char *addr);
+
+//Funcao para copiar nbytes do arquivo fdIn, a partir de offsetIn, para o
+//arquivo fdOut, a partir de offsetOut, sem passar os dados por buffers do
+//chamador. Os cursores nao sao alterados. Retorna o numero de bytes copiados
+//em caso de sucesso (0 se offsetIn estiver no fim da origem) ou -1, caso
+//contrario
+int vfsCopyRange (int fdIn, unsigned int offsetIn, int fdOut,
+                  unsigned int offsetOut, unsigned int nbytes);
+
+//Funcao para ligar (append diferente de 0) ou desligar o modo de acrescimo
+//de um arquivo aberto. Nesse modo, vfsWrite e vfsWritev sempre escrevem no
+//fim do arquivo, como em um log. Retorna 0 caso bem sucedido, ou -1 caso
+//contrario
+int vfsSetAppend (int fd, int append);
+
+//Funcao para a leitura de um arquivo a partir da posicao offset, de 64 bits,
+//sem uso nem alteracao do cursor do descritor de arquivo. Retorna o numero de
+//bytes efetivamente lidos em caso de sucesso ou -1, caso contrario.
+int vfsPread64 (int fd, char *buf, unsigned int nbytes,
+                unsigned long long offset);
+
+//Funcao para a escrita de um arquivo a partir da posicao offset, de 64 bits,
+//sem uso nem alteracao do cursor do descritor de arquivo. Retorna o numero de
+//bytes efetivamente escritos em caso de sucesso ou -1, caso contrario
+int vfsPwrite64 (int fd, const char *buf, unsigned int nbytes,
+                 unsigned long long offset);
+
+//Funcao para posicionar o cursor de um arquivo aberto na posicao offset, de
+//64 bits. Retorna a nova posicao do cursor em caso de sucesso ou -1, caso
+//contrario
+long long vfsSeek64 (int fd, unsigned long long offset);
+
+//Funcao para pre-alocacao de espaco de um arquivo, como vfsAllocate, com
+//offset e nbytes de 64 bits. Retorna 0 caso bem sucedido, ou -1 caso
+//contrario
+int vfsAllocate64 (int fd, unsigned long long offset,
+                   unsigned long long nbytes);
+
+//Funcao para alterar o tamanho de um arquivo aberto para size bytes, como
+//vfsTruncate, com tamanho de 64 bits. Retorna 0 caso bem sucedido, ou -1 caso
+//contrario
+int vfsTruncate64 (int fd, unsigned long long size);
+
+//Funcao para copiar nbytes entre arquivos abertos, como vfsCopyRange, com
+//posicoes de 64 bits. Retorna o numero de bytes copiados em caso de sucesso
+//ou -1, caso contrario
+int vfsCopyRange64 (int fdIn, unsigned long long offsetIn, int fdOut,
+                    unsigned long long offsetOut, unsigned int nbytes);
+
+//Funcao para mapear em memoria length bytes de um arquivo aberto, como
+//vfsMmap, a partir da posicao offset, de 64 bits. Retorna o endereco do
+//mapeamento em caso de sucesso ou NULL, caso contrario
+char* vfsMmap64 (int fd, unsigned long long offset, unsigned int length);
+
+//Funcao para obtencao de informacoes de ocupacao (blocos e i-nodes livres)
+//do sistema de arquivos raiz, copiadas para st. Retorna 0 caso bem sucedido,
+//ou -1 caso contrario
+int vfsStatfs (FSStat *st);
+
+//Funcao para sincronizacao do sistema de arquivos raiz, gravando em disco
+//todos os dados e metadados mantidos em memoria. Retorna 0 caso bem
+//sucedido, ou -1 caso contrario
+int vfsSync (void);
+
 //Funcao para abertura de um diretorio, a partir do caminho especificado em
 //path, no modo Read/Write, criando o diretorio se nao existir. Retorna um
 //descritor de arquivo, em caso de sucesso. Retorna -1, caso contrario.
@@ -146,6 +422,20 @@ int vfsOpendir (const char *path);
 //foi lida, 0 se fim de diretorio ou -1 caso mal sucedido
 int vfsReaddir (int fd, char *filename, unsigned int *inumber);
 
+//Funcao para a leitura de ate maxEntries entradas de um diretorio,
+//identificado por um descritor de arquivo existente, a partir da posicao
+//atual do cursor no diretorio, que avanca. As entradas sao copiadas para
+//entries. Retorna o numero de entradas lidas, 0 se fim de diretorio ou -1
+//caso mal sucedido
+int vfsGetdents (int fd, FSDirent *entries, unsigned int maxEntries);
+
+//Funcao para a leitura de ate maxEntries entradas de um diretorio,
+//identificado por um descritor de arquivo existente, cujos nomes comecam por
+//prefix, a partir da posicao atual do cursor no diretorio, que avanca.
+//Retorna o numero de entradas lidas, 0 se nao houver mais entradas com o
+//prefixo ou -1 caso mal sucedido
+int vfsGetdentsPrefix (int fd, const char *prefix, FSDirent *entries, unsigned int maxEntries);
+
 //Funcao para adicionar uma entrada a um diretorio, identificado por um 
 //descritor de arquivo existente. A nova entrada tera' o nome indicado por
 //filename e apontara' para o numero de i-node indicado por inumber. Retorna 0\
@@ -157,6 +447,13 @@ int vfsLink (int fd, const char *filename, unsigned int inumber);
 //indicado em filename. Retorna 0 caso bem sucedido, ou -1 caso contrario.
 int vfsUnlink (int fd, const char *filename);
 
+//Funcao para criar de uma so vez, em um diretorio identificado por um
+//descritor de arquivo existente, numNames arquivos vazios com os nomes
+//indicados em names. Os arquivos nao sao abertos, e a criacao para no
+//primeiro nome invalido ou ja existente. Retorna o numero de arquivos
+//criados, ou -1 caso mal sucedido.
+int vfsCreateMany (int fd, const char **names, unsigned int numNames);
+
 //Funcao para fechar um diretorio, identificado por um descritor de arquivo
 //existente. Retorna 0 caso bem sucedido, ou -1 caso contrario.
 int vfsClosedir (int fd);